@@ -0,0 +1,439 @@
+#ifndef SJTU_ALGORITHM_HPP
+#define SJTU_ALGORITHM_HPP
+
+#include "deque.h"
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SJTU_SIMD_X86
+#endif
+
+/*
+ * 针对sjtu::deque的查找和统计算法.
+ * 元素直接存放在块内时,每个块最多是两段连续内存,逐段交给向量化的内核处理;
+ * x86上运行时检测AVX2,否则用SSE2宽度,其余平台和非算术类型退回逐个比较.
+ */
+namespace sjtu {
+    // 求和结果的类型:整数用64位累加,浮点用double
+    template<class T>
+    struct sum_type {
+        typedef typename std::conditional<std::is_floating_point<T>::value, double,
+            typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type>::type type;
+    };
+
+    // sum/min_element/max_element要求的元素类型
+    template<class T>
+    struct simd_arithmetic {
+        static const bool value = std::is_arithmetic<T>::value && !std::is_same<T, bool>::value;
+    };
+
+    // find/count只对4字节和8字节的算术类型走向量内核,更窄的类型按车道计数会溢出
+    template<class T>
+    struct simd_eligible {
+        static const bool value = simd_arithmetic<T>::value && (sizeof(T) == 4 || sizeof(T) == 8);
+    };
+
+#ifdef SJTU_SIMD_X86
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+    // Bytes字节宽的向量内核,由GCC向量扩展实现,内联进带target属性的包装函数后生成对应指令
+    template<class T, int Bytes>
+    struct simd_kernel {
+        typedef T vec __attribute__((vector_size(Bytes)));
+        typedef decltype(vec() == vec()) mask;
+        typedef typename sum_type<T>::type acc_type;
+        typedef acc_type wide __attribute__((vector_size(Bytes / sizeof(T) * sizeof(acc_type))));
+        static constexpr size_t lanes = Bytes / sizeof(T);
+        static constexpr size_t chunk = 8 * lanes;
+
+        __attribute__((always_inline)) static inline vec load(const T *p) {
+            vec v;
+            memcpy(&v, p, sizeof(vec));
+            return v;
+        }
+
+        // 返回第一个等于value的下标,不存在时返回n
+        __attribute__((always_inline)) static inline size_t find(const T *p, size_t n, T value) {
+            vec target = vec() + value;
+            size_t i = 0;
+            for (; i + chunk <= n; i += chunk) {
+                mask hit = mask();
+                for (size_t j = 0; j < chunk; j += lanes) {
+                    hit |= load(p + i + j) == target;
+                }
+                bool any = false;
+                for (size_t l = 0; l < lanes; l++) {
+                    any |= hit[l] != 0;
+                }
+                if (any) {
+                    break;
+                }
+            }
+            for (; i < n; i++) {
+                if (p[i] == value) {
+                    return i;
+                }
+            }
+            return n;
+        }
+
+        __attribute__((always_inline)) static inline size_t count(const T *p, size_t n, T value) {
+            vec target = vec() + value;
+            mask acc = mask();
+            size_t i = 0;
+            for (; i + lanes <= n; i += lanes) {
+                acc -= load(p + i) == target;
+            }
+            size_t result = 0;
+            for (size_t l = 0; l < lanes; l++) {
+                result += static_cast<size_t>(acc[l]);
+            }
+            for (; i < n; i++) {
+                result += p[i] == value;
+            }
+            return result;
+        }
+
+        // n至少为1
+        __attribute__((always_inline)) static inline T min(const T *p, size_t n) {
+            T result = p[0];
+            size_t i = 0;
+            if (n >= lanes) {
+                vec acc = load(p);
+                for (i = lanes; i + lanes <= n; i += lanes) {
+                    vec v = load(p + i);
+                    acc = v < acc ? v : acc;
+                }
+                for (size_t l = 0; l < lanes; l++) {
+                    if (acc[l] < result) {
+                        result = acc[l];
+                    }
+                }
+            }
+            for (; i < n; i++) {
+                if (p[i] < result) {
+                    result = p[i];
+                }
+            }
+            return result;
+        }
+
+        __attribute__((always_inline)) static inline T max(const T *p, size_t n) {
+            T result = p[0];
+            size_t i = 0;
+            if (n >= lanes) {
+                vec acc = load(p);
+                for (i = lanes; i + lanes <= n; i += lanes) {
+                    vec v = load(p + i);
+                    acc = acc < v ? v : acc;
+                }
+                for (size_t l = 0; l < lanes; l++) {
+                    if (result < acc[l]) {
+                        result = acc[l];
+                    }
+                }
+            }
+            for (; i < n; i++) {
+                if (result < p[i]) {
+                    result = p[i];
+                }
+            }
+            return result;
+        }
+
+        __attribute__((always_inline)) static inline acc_type sum(const T *p, size_t n) {
+            wide acc = wide();
+            size_t i = 0;
+            for (; i + lanes <= n; i += lanes) {
+                acc += __builtin_convertvector(load(p + i), wide);
+            }
+            acc_type result = 0;
+            for (size_t l = 0; l < lanes; l++) {
+                result += acc[l];
+            }
+            for (; i < n; i++) {
+                result += p[i];
+            }
+            return result;
+        }
+    };
+
+    inline bool simd_has_avx2() {
+        static const bool has = __builtin_cpu_supports("avx2");
+        return has;
+    }
+
+    template<class T>
+    __attribute__((target("avx2"))) size_t simd_find_avx2(const T *p, size_t n, T value) {
+        return simd_kernel<T, 32>::find(p, n, value);
+    }
+
+    template<class T>
+    __attribute__((target("avx2"))) size_t simd_count_avx2(const T *p, size_t n, T value) {
+        return simd_kernel<T, 32>::count(p, n, value);
+    }
+
+    template<class T>
+    __attribute__((target("avx2"))) T simd_min_avx2(const T *p, size_t n) {
+        return simd_kernel<T, 32>::min(p, n);
+    }
+
+    template<class T>
+    __attribute__((target("avx2"))) T simd_max_avx2(const T *p, size_t n) {
+        return simd_kernel<T, 32>::max(p, n);
+    }
+
+    template<class T>
+    __attribute__((target("avx2"))) typename sum_type<T>::type simd_sum_avx2(const T *p, size_t n) {
+        return simd_kernel<T, 32>::sum(p, n);
+    }
+
+    // 按CPU能力选择内核的各个入口
+    template<class T>
+    size_t span_find(const T *p, size_t n, T value) {
+        return simd_has_avx2() ? simd_find_avx2(p, n, value) : simd_kernel<T, 16>::find(p, n, value);
+    }
+
+    template<class T>
+    size_t span_count(const T *p, size_t n, T value) {
+        return simd_has_avx2() ? simd_count_avx2(p, n, value) : simd_kernel<T, 16>::count(p, n, value);
+    }
+
+    template<class T>
+    T span_min(const T *p, size_t n) {
+        return simd_has_avx2() ? simd_min_avx2(p, n) : simd_kernel<T, 16>::min(p, n);
+    }
+
+    template<class T>
+    T span_max(const T *p, size_t n) {
+        return simd_has_avx2() ? simd_max_avx2(p, n) : simd_kernel<T, 16>::max(p, n);
+    }
+
+    template<class T>
+    typename sum_type<T>::type span_sum(const T *p, size_t n) {
+        return simd_has_avx2() ? simd_sum_avx2(p, n) : simd_kernel<T, 16>::sum(p, n);
+    }
+#pragma GCC diagnostic pop
+#else
+    template<class T>
+    size_t span_find(const T *p, size_t n, T value) {
+        for (size_t i = 0; i < n; i++) {
+            if (p[i] == value) {
+                return i;
+            }
+        }
+        return n;
+    }
+
+    template<class T>
+    size_t span_count(const T *p, size_t n, T value) {
+        size_t result = 0;
+        for (size_t i = 0; i < n; i++) {
+            result += p[i] == value;
+        }
+        return result;
+    }
+
+    template<class T>
+    T span_min(const T *p, size_t n) {
+        T result = p[0];
+        for (size_t i = 1; i < n; i++) {
+            if (p[i] < result) {
+                result = p[i];
+            }
+        }
+        return result;
+    }
+
+    template<class T>
+    T span_max(const T *p, size_t n) {
+        T result = p[0];
+        for (size_t i = 1; i < n; i++) {
+            if (result < p[i]) {
+                result = p[i];
+            }
+        }
+        return result;
+    }
+
+    template<class T>
+    typename sum_type<T>::type span_sum(const T *p, size_t n) {
+        typename sum_type<T>::type result = 0;
+        for (size_t i = 0; i < n; i++) {
+            result += p[i];
+        }
+        return result;
+    }
+#endif
+
+    /**
+     * 依次把每个块的连续段交给f(const T *p, size_t n, Block *block, size_t offset, size_t cur),
+     * offset是段首在块内的下标,cur是段首在整个deque中的下标.f返回true时提前结束.
+     * 只适用于元素直接存放在块内的情形.
+     */
+    template<class T, class Monoid, class F>
+    void for_each_span(const deque<T, Monoid> &q, F f) {
+        static_assert(!deque_slot<T>::owns_heap, "for_each_span requires inline storage");
+        size_t cur = 0;
+        for (typename deque<T, Monoid>::Block *block = q.head_block; block != nullptr; block = block->next) {
+            size_t first = std::min(block->size, block->capacity - block->head);
+            if (first > 0 && f(block->data + block->head, first, block, 0, cur)) {
+                return;
+            }
+            if (block->size > first && f(block->data, block->size - first, block, first, cur + first)) {
+                return;
+            }
+            cur += block->size;
+        }
+    }
+
+    // 第一个等于value的元素所在的块、块内下标和全局下标,找不到时block为nullptr
+    template<class T, class Monoid>
+    struct find_result {
+        typename deque<T, Monoid>::Block *block;
+        size_t index;
+        size_t cur;
+    };
+
+    template<class T, class Monoid>
+    find_result<T, Monoid> find_position(const deque<T, Monoid> &q, const T &value, std::true_type) {
+        find_result<T, Monoid> result = {nullptr, 0, 0};
+        for_each_span(q, [&](const T *p, size_t n, typename deque<T, Monoid>::Block *block, size_t offset,
+                             size_t cur) {
+            size_t i = span_find(p, n, value);
+            if (i == n) {
+                return false;
+            }
+            result.block = block;
+            result.index = offset + i;
+            result.cur = cur + i;
+            return true;
+        });
+        return result;
+    }
+
+    template<class T, class Monoid>
+    find_result<T, Monoid> find_position(const deque<T, Monoid> &q, const T &value, std::false_type) {
+        size_t cur = 0;
+        for (typename deque<T, Monoid>::Block *block = q.head_block; block != nullptr; block = block->next) {
+            for (size_t i = 0; i < block->size; i++) {
+                if (deque_slot<T>::ref(block->at(i)) == value) {
+                    find_result<T, Monoid> result = {block, i, cur + i};
+                    return result;
+                }
+            }
+            cur += block->size;
+        }
+        find_result<T, Monoid> result = {nullptr, 0, 0};
+        return result;
+    }
+
+    /**
+     * return an iterator to the first element equal to value, or end().
+     */
+    template<class T, class Monoid>
+    typename deque<T, Monoid>::iterator find(deque<T, Monoid> &q, const T &value) {
+        find_result<T, Monoid> pos = find_position(q, value, std::integral_constant<bool, simd_eligible<T>::value>());
+        if (pos.block == nullptr) {
+            return q.end();
+        }
+        return typename deque<T, Monoid>::iterator(pos.block, pos.index, pos.cur, &q);
+    }
+
+    template<class T, class Monoid>
+    typename deque<T, Monoid>::const_iterator find(const deque<T, Monoid> &q, const T &value) {
+        find_result<T, Monoid> pos = find_position(q, value, std::integral_constant<bool, simd_eligible<T>::value>());
+        if (pos.block == nullptr) {
+            return q.cend();
+        }
+        return typename deque<T, Monoid>::const_iterator(pos.block, pos.index, pos.cur, &q);
+    }
+
+    template<class T, class Monoid>
+    size_t count_impl(const deque<T, Monoid> &q, const T &value, std::true_type) {
+        size_t result = 0;
+        for_each_span(q, [&](const T *p, size_t n, typename deque<T, Monoid>::Block *, size_t, size_t) {
+            result += span_count(p, n, value);
+            return false;
+        });
+        return result;
+    }
+
+    template<class T, class Monoid>
+    size_t count_impl(const deque<T, Monoid> &q, const T &value, std::false_type) {
+        size_t result = 0;
+        for (auto it = q.cbegin(); it != q.cend(); ++it) {
+            result += *it == value;
+        }
+        return result;
+    }
+
+    /**
+     * return the number of elements equal to value.
+     */
+    template<class T, class Monoid>
+    size_t count(const deque<T, Monoid> &q, const T &value) {
+        return count_impl(q, value, std::integral_constant<bool, simd_eligible<T>::value>());
+    }
+
+    /**
+     * return the sum of all elements, accumulated in sum_type<T>::type.
+     * floating point sums are reassociated across vector lanes.
+     */
+    template<class T, class Monoid>
+    typename sum_type<T>::type sum(const deque<T, Monoid> &q) {
+        static_assert(simd_arithmetic<T>::value, "sum requires an arithmetic element type");
+        typename sum_type<T>::type result = 0;
+        for_each_span(q, [&](const T *p, size_t n, typename deque<T, Monoid>::Block *, size_t, size_t) {
+            result += span_sum(p, n);
+            return false;
+        });
+        return result;
+    }
+
+    // 最小值/最大值先逐段求出数值,再定位它第一次出现的位置
+    template<class T, class Monoid>
+    typename deque<T, Monoid>::const_iterator min_element(const deque<T, Monoid> &q) {
+        static_assert(simd_arithmetic<T>::value, "min_element requires an arithmetic element type");
+        if (q.empty()) {
+            return q.cend();
+        }
+        bool first = true;
+        T best = T();
+        for_each_span(q, [&](const T *p, size_t n, typename deque<T, Monoid>::Block *, size_t, size_t) {
+            T value = span_min(p, n);
+            if (first || value < best) {
+                best = value;
+                first = false;
+            }
+            return false;
+        });
+        typename deque<T, Monoid>::const_iterator result = find(q, best);
+        return result == q.cend() ? q.cbegin() : result; // 只有NaN找不到自身
+    }
+
+    template<class T, class Monoid>
+    typename deque<T, Monoid>::const_iterator max_element(const deque<T, Monoid> &q) {
+        static_assert(simd_arithmetic<T>::value, "max_element requires an arithmetic element type");
+        if (q.empty()) {
+            return q.cend();
+        }
+        bool first = true;
+        T best = T();
+        for_each_span(q, [&](const T *p, size_t n, typename deque<T, Monoid>::Block *, size_t, size_t) {
+            T value = span_max(p, n);
+            if (first || best < value) {
+                best = value;
+                first = false;
+            }
+            return false;
+        });
+        typename deque<T, Monoid>::const_iterator result = find(q, best);
+        return result == q.cend() ? q.cbegin() : result;
+    }
+}
+
+#endif
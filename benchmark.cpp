@@ -0,0 +1,731 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <new>
+#include <utility>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "deque.h"
+#include "class-bint.h"
+#include "class-fixed-bint.h"
+#include "class-matrix.h"
+#include "algorithm.h"
+#include "monotonic-deque.h"
+
+/*
+ * Microbenchmarks for sjtu::deque against std::deque, std::vector and a ring buffer.
+ *
+ * build: g++ -std=c++14 -O2 -pthread -o benchmark benchmark.cpp
+ * usage: ./benchmark [max_exponent] [heavy_max_exponent] [stream_exponent] [multiply_exponent]
+ *   sizes run over 10^2 .. 10^max_exponent (default 6) for int and Pod64,
+ *   and over 10^2 .. 10^heavy_max_exponent (default 4) for Bint and Matrix.
+ *
+ * Every (container, type, size) case runs in a forked child so that peak RSS
+ * belongs to that case alone. One CSV line is printed per measured operation:
+ *   container,type,n,op,ops,ns_per_op,allocs_per_op,peak_rss_kb
+ *
+ * The sjtu algorithms in algorithm.h (find, count, min_element, max_element,
+ * sum) are measured for int and double, each against the same scan written
+ * with deque::const_iterator ("_simd" and "_iterator" ops respectively).
+ *
+ * sjtu::monotonic_deque::slide() is measured on a pseudo-random int stream of
+ * 10^stream_exponent (default 8) elements for windows of 16, 1024 and 65536
+ * (reported as n), against the same monotonic queue built on std::deque.
+ *
+ * Util::Bint multiplication is measured for operands of 10, 30, 100, ... up to
+ * 10^multiply_exponent (default 6) decimal digits (reported as n), once with the
+ * size-based dispatch ("multiply") and once forced to schoolbook
+ * ("multiply_schoolbook", up to 10^5 digits). The dispatch thresholds are tuned
+ * with Bint::tuneMultiply() first and printed to stderr.
+ *
+ * Bint division is measured for 10^3 .. 10^5-digit divisors ("divide": a
+ * 2n-digit number by an n-digit one; "divide_small": n digits by one limb),
+ * and powmod with an n-digit modulus and a 20-digit exponent, once with the
+ * built-in Barrett reduction ("powmod") and once reducing with operator%
+ * after every multiplication ("powmod_remainder", up to 3 * 10^4 digits).
+ *
+ * Bint decimal I/O is measured for 10^3 .. 10^multiply_exponent digits:
+ * "to_chars"/"from_chars" on a preallocated buffer, operator<< and operator>>
+ * on string streams ("print"/"parse"), and the former per-limb
+ * std::setw/std::setfill formatting ("print_setw") for comparison.
+ *
+ * Bint addition, subtraction and comparison are measured in place on
+ * 10^5 .. 10^7-limb operands ("add", "subtract", "compare" of equal values),
+ * with the AVX2 kernels ("_simd") and with Bint::simdKernels turned off.
+ *
+ * Summing a sjtu::deque of 10^5 Bints of about 100 digits is measured with
+ * "sum = sum + x" ("accumulate_copy") and "sum += x" ("accumulate_inplace").
+ *
+ * Bint expressions with temporaries, "r = a + b * c - d" on n-digit operands
+ * for n = 10^2 .. 10^5, are measured with the per-thread arena ("expression")
+ * and with Bint::arenaBytes = 0 ("expression_noarena").
+ *
+ * Util::FixedBint<256> is measured against Util::Bint on sjtu::deques of 1000
+ * values of 35 decimal digits (reported as n): "add" sums the deque, "multiply"
+ * and "divide" combine neighbouring elements (the product fits in 256 bits).
+ *
+ * Multithreaded Bint multiplication is measured for 10^6- and 10^7-digit
+ * operands with Bint::multiplyThreads set to 1, 2, 4, 8 and 16
+ * ("multiply_threads_<k>"); the scaling is bounded by the cores available.
+ */
+
+/***************************/
+static size_t g_allocs = 0;
+/***************************/
+
+// 所有形式的new/delete都经过这一对函数;不内联,编译器看到的始终是成对的new/delete,而不是new配free
+__attribute__((noinline)) static void *counted_alloc(size_t size) {
+    g_allocs++;
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+__attribute__((noinline)) static void counted_free(void *p) noexcept { free(p); }
+
+void *operator new(size_t size) { return counted_alloc(size); }
+void *operator new[](size_t size) { return counted_alloc(size); }
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete[](void *p) noexcept { counted_free(p); }
+void operator delete(void *p, size_t) noexcept { counted_free(p); }
+void operator delete[](void *p, size_t) noexcept { counted_free(p); }
+
+struct Pod64 {
+    long long v[8];
+};
+
+// 简单的环形缓冲区,容量按2的幂翻倍
+template<class T>
+class ring_buffer {
+    T *data = nullptr;
+    size_t capacity = 0, head = 0, count = 0;
+
+    void grow() {
+        size_t new_capacity = capacity ? capacity << 1 : 16;
+        T *new_data = static_cast<T *>(::operator new(new_capacity * sizeof(T)));
+        for (size_t i = 0; i < count; i++) {
+            T &old = data[(head + i) & (capacity - 1)];
+            new (new_data + i) T(old);
+            old.~T();
+        }
+        ::operator delete(data);
+        data = new_data;
+        capacity = new_capacity;
+        head = 0;
+    }
+
+public:
+    typedef T value_type;
+
+    ring_buffer() {}
+    ring_buffer(const ring_buffer &other) {
+        for (size_t i = 0; i < other.count; i++) push_back(other[i]);
+    }
+    ~ring_buffer() {
+        clear();
+        ::operator delete(data);
+    }
+    ring_buffer &operator=(ring_buffer other) {
+        swap(other);
+        return *this;
+    }
+    void swap(ring_buffer &other) {
+        std::swap(data, other.data);
+        std::swap(capacity, other.capacity);
+        std::swap(head, other.head);
+        std::swap(count, other.count);
+    }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T &operator[](size_t pos) { return data[(head + pos) & (capacity - 1)]; }
+    const T &operator[](size_t pos) const { return data[(head + pos) & (capacity - 1)]; }
+    T &at(size_t pos) { return (*this)[pos]; }
+    void push_back(const T &value) {
+        if (count == capacity) grow();
+        new (data + ((head + count) & (capacity - 1))) T(value);
+        count++;
+    }
+    void push_front(const T &value) {
+        if (count == capacity) grow();
+        head = (head + capacity - 1) & (capacity - 1);
+        new (data + head) T(value);
+        count++;
+    }
+    void pop_back() {
+        (*this)[count - 1].~T();
+        count--;
+    }
+    void pop_front() {
+        data[head].~T();
+        head = (head + 1) & (capacity - 1);
+        count--;
+    }
+    void clear() {
+        while (count) pop_back();
+    }
+};
+
+template<class T> struct element;
+
+template<> struct element<int> {
+    static const char *name() { return "int"; }
+    static int make(size_t i) { return static_cast<int>(i); }
+    static size_t key(const int &x) { return static_cast<size_t>(x); }
+};
+
+template<> struct element<double> {
+    static const char *name() { return "double"; }
+    static double make(size_t i) { return static_cast<double>(i); }
+    static size_t key(const double &x) { return static_cast<size_t>(x); }
+};
+
+template<> struct element<Pod64> {
+    static const char *name() { return "pod64"; }
+    static Pod64 make(size_t i) {
+        Pod64 p;
+        for (int k = 0; k < 8; k++) p.v[k] = static_cast<long long>(i) + k;
+        return p;
+    }
+    static size_t key(const Pod64 &x) { return static_cast<size_t>(x.v[0]); }
+};
+
+template<> struct element<Util::Bint> {
+    static const char *name() { return "bint"; }
+    static Util::Bint make(size_t i) { return Util::Bint(static_cast<long long>(i) * 1000003LL); }
+    static size_t key(const Util::Bint &x) {
+        static const Util::Bint zero;
+        return x == zero ? 0 : 1;
+    }
+};
+
+template<> struct element<Diamond::Matrix<double> > {
+    static const char *name() { return "matrix"; }
+    static Diamond::Matrix<double> make(size_t i) { return Diamond::Matrix<double>(2, 2, static_cast<double>(i)); }
+    static size_t key(const Diamond::Matrix<double> &x) { return static_cast<size_t>(x[0][0]); }
+};
+
+template<class C> struct container_name;
+template<class T> struct container_name<sjtu::deque<T> > { static const char *get() { return "sjtu::deque"; } };
+template<class T> struct container_name<std::deque<T> > { static const char *get() { return "std::deque"; } };
+template<class T> struct container_name<std::vector<T> > { static const char *get() { return "std::vector"; } };
+template<class T> struct container_name<ring_buffer<T> > { static const char *get() { return "ring_buffer"; } };
+
+// std::vector没有头部操作,环形缓冲区没有中间插入删除
+template<class C> struct has_front { static const bool value = true; };
+template<class T> struct has_front<std::vector<T> > { static const bool value = false; };
+template<class C> struct has_middle { static const bool value = true; };
+template<class T> struct has_middle<ring_buffer<T> > { static const bool value = false; };
+
+template<class C> void push_front(C &c, const typename C::value_type &v) { c.push_front(v); }
+template<class T> void push_front(std::vector<T> &, const T &) {}
+template<class C> void pop_front(C &c) { c.pop_front(); }
+template<class T> void pop_front(std::vector<T> &) {}
+template<class C> void insert_at(C &c, size_t pos, const typename C::value_type &v) { c.insert(c.begin() + pos, v); }
+template<class T> void insert_at(ring_buffer<T> &, size_t, const T &) {}
+template<class C> void erase_at(C &c, size_t pos) { c.erase(c.begin() + pos); }
+template<class T> void erase_at(ring_buffer<T> &, size_t) {}
+
+template<class C> size_t iterate(const C &c) {
+    typedef typename C::value_type T;
+    size_t sum = 0;
+    for (auto it = c.begin(); it != c.end(); ++it) sum += element<T>::key(*it);
+    return sum;
+}
+template<class T> size_t iterate(const ring_buffer<T> &c) {
+    size_t sum = 0;
+    for (size_t i = 0; i < c.size(); i++) sum += element<T>::key(c[i]);
+    return sum;
+}
+
+volatile size_t g_sink;
+
+class timer {
+    const char *container, *type, *op;
+    size_t n, ops, allocs;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    timer(const char *container, const char *type, size_t n, const char *op, size_t ops)
+        : container(container), type(type), op(op), n(n), ops(ops ? ops : 1), allocs(g_allocs),
+          start(std::chrono::steady_clock::now()) {}
+    ~timer() {
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        size_t used = g_allocs - allocs;
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        printf("%s,%s,%zu,%s,%zu,%.2f,%.3f,%ld\n", container, type, n, op, ops, ns / ops,
+               static_cast<double>(used) / ops, usage.ru_maxrss);
+    }
+};
+
+template<class C>
+void run_case(size_t n) {
+    typedef typename C::value_type T;
+    const char *cname = container_name<C>::get();
+    const char *tname = element<T>::name();
+    size_t middle_ops = n < 1000 ? n : 1000;
+    size_t random_ops = n < 100000 ? n : 100000;
+    srand(20250310);
+
+    C c;
+    {
+        timer t(cname, tname, n, "push_back", n);
+        for (size_t i = 0; i < n; i++) c.push_back(element<T>::make(i));
+    }
+    {
+        size_t sum = 0;
+        timer t(cname, tname, n, "random_at", random_ops);
+        for (size_t i = 0; i < random_ops; i++) sum += element<T>::key(c.at(rand() % n));
+        g_sink = sum;
+    }
+    {
+        timer t(cname, tname, n, "iterate", n);
+        g_sink = iterate(c);
+    }
+    if (has_middle<C>::value) {
+        {
+            timer t(cname, tname, n, "insert_middle", middle_ops);
+            for (size_t i = 0; i < middle_ops; i++) insert_at(c, c.size() / 2, element<T>::make(i));
+        }
+        {
+            timer t(cname, tname, n, "erase_middle", middle_ops);
+            for (size_t i = 0; i < middle_ops; i++) erase_at(c, c.size() / 2);
+        }
+    }
+    {
+        timer t(cname, tname, n, "copy", n);
+        C other(c);
+        g_sink = other.size();
+    }
+    {
+        timer t(cname, tname, n, "pop_back", n);
+        for (size_t i = 0; i < n; i++) c.pop_back();
+    }
+    if (has_front<C>::value) {
+        {
+            timer t(cname, tname, n, "push_front", n);
+            for (size_t i = 0; i < n; i++) push_front(c, element<T>::make(i));
+        }
+        {
+            timer t(cname, tname, n, "pop_front", n);
+            for (size_t i = 0; i < n; i++) pop_front(c);
+        }
+    }
+    for (size_t i = 0; i < n; i++) c.push_back(element<T>::make(i));
+    {
+        timer t(cname, tname, n, "clear", n);
+        c.clear();
+    }
+}
+
+template<class T>
+void run_algorithm_case(size_t n) {
+    const char *tname = element<T>::name();
+    sjtu::deque<T> q;
+    for (size_t i = 0; i < n; i++) q.push_back(static_cast<T>(i % 1000003));
+    const sjtu::deque<T> &c = q;
+    const T missing = static_cast<T>(-1);
+    {
+        timer t("sjtu::deque", tname, n, "find_simd", n);
+        g_sink = sjtu::find(c, missing) == c.cend();
+    }
+    {
+        timer t("sjtu::deque", tname, n, "find_iterator", n);
+        auto it = c.cbegin();
+        while (it != c.cend() && *it != missing) ++it;
+        g_sink = it == c.cend();
+    }
+    {
+        timer t("sjtu::deque", tname, n, "count_simd", n);
+        g_sink = sjtu::count(c, static_cast<T>(7));
+    }
+    {
+        timer t("sjtu::deque", tname, n, "count_iterator", n);
+        size_t result = 0;
+        for (auto it = c.cbegin(); it != c.cend(); ++it) result += *it == static_cast<T>(7);
+        g_sink = result;
+    }
+    {
+        timer t("sjtu::deque", tname, n, "min_element_simd", n);
+        g_sink = sjtu::min_element(c) - c.cbegin();
+    }
+    {
+        timer t("sjtu::deque", tname, n, "min_element_iterator", n);
+        auto best = c.cbegin();
+        for (auto it = c.cbegin(); it != c.cend(); ++it) if (*it < *best) best = it;
+        g_sink = best - c.cbegin();
+    }
+    {
+        timer t("sjtu::deque", tname, n, "max_element_simd", n);
+        g_sink = sjtu::max_element(c) - c.cbegin();
+    }
+    {
+        timer t("sjtu::deque", tname, n, "max_element_iterator", n);
+        auto best = c.cbegin();
+        for (auto it = c.cbegin(); it != c.cend(); ++it) if (*best < *it) best = it;
+        g_sink = best - c.cbegin();
+    }
+    {
+        timer t("sjtu::deque", tname, n, "sum_simd", n);
+        g_sink = static_cast<size_t>(sjtu::sum(c));
+    }
+    {
+        timer t("sjtu::deque", tname, n, "sum_iterator", n);
+        typename sjtu::sum_type<T>::type result = 0;
+        for (auto it = c.cbegin(); it != c.cend(); ++it) result += *it;
+        g_sink = static_cast<size_t>(result);
+    }
+}
+
+// 不落地的伪随机int流,10^8个元素不必先存下来
+class stream_iterator {
+    size_t index;
+    uint64_t state;
+
+public:
+    explicit stream_iterator(size_t index): index(index), state(88172645463325252ULL) {}
+    int operator*() const { return static_cast<int>(state >> 33); }
+    stream_iterator &operator++() {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        index++;
+        return *this;
+    }
+    bool operator!=(const stream_iterator &other) const { return index != other.index; }
+};
+
+static size_t g_stream_length = 100000000;
+
+void run_monotonic_case(size_t window) {
+    size_t sum = 0;
+    {
+        timer t("sjtu::monotonic_deque", "int", window, "slide", g_stream_length);
+        sjtu::monotonic_deque<int> q;
+        q.slide(stream_iterator(0), stream_iterator(g_stream_length), window,
+                [&](const int &lo, const int &hi) { sum += static_cast<size_t>(hi - lo); });
+    }
+    g_sink = sum;
+    sum = 0;
+    {
+        timer t("std::deque", "int", window, "slide", g_stream_length);
+        std::deque<std::pair<size_t, int> > mins, maxs;
+        size_t seq = 0;
+        for (stream_iterator it(0), end(g_stream_length); it != end; ++it, ++seq) {
+            int x = *it;
+            while (!mins.empty() && mins.back().second >= x) mins.pop_back();
+            while (!maxs.empty() && maxs.back().second <= x) maxs.pop_back();
+            mins.emplace_back(seq, x);
+            maxs.emplace_back(seq, x);
+            if (mins.front().first + window <= seq) mins.pop_front();
+            if (maxs.front().first + window <= seq) maxs.pop_front();
+            sum += static_cast<size_t>(maxs.front().second - mins.front().second);
+        }
+    }
+    g_sink = sum;
+}
+
+// digits位的伪随机十进制数
+std::string random_digits(size_t digits, size_t seed) {
+    std::string s(digits, '0');
+    stream_iterator it(0);
+    for (size_t i = 0; i < seed; i++) ++it;
+    for (size_t i = 0; i < digits; i++, ++it) s[i] = static_cast<char>('0' + *it % 10);
+    s[0] = '9';
+    return s;
+}
+
+void run_bint_multiply_case(size_t digits) {
+    Util::Bint a(random_digits(digits, 1)), b(random_digits(digits, 2));
+    size_t ops = digits < 2000000 ? 2000000 / digits : 1;
+    {
+        timer t("Util::Bint", "Bint", digits, "multiply", ops);
+        for (size_t i = 0; i < ops; i++) g_sink = (a * b) != a;
+    }
+    if (digits > 100000) return;
+    Util::Bint::MultiplyThresholds saved = Util::Bint::multiplyThresholds;
+    Util::Bint::multiplyThresholds.karatsuba = Util::Bint::multiplyThresholds.toom3 =
+        Util::Bint::multiplyThresholds.ntt = static_cast<size_t>(-1);
+    ops = digits < 100000 ? 100000 / digits : 1;
+    {
+        timer t("Util::Bint", "Bint", digits, "multiply_schoolbook", ops);
+        for (size_t i = 0; i < ops; i++) g_sink = (a * b) != a;
+    }
+    Util::Bint::multiplyThresholds = saved;
+}
+
+void run_bint_division_case(size_t digits) {
+    Util::Bint a(random_digits(2 * digits, 1)), b(random_digits(digits, 2)), m(random_digits(digits, 3));
+    Util::Bint e("12345678901234567890");
+    size_t ops = digits <= 1000 ? 100 : digits <= 10000 ? 10 : 1;
+    {
+        timer t("Util::Bint", "Bint", digits, "divide", ops);
+        for (size_t i = 0; i < ops; i++) g_sink = (a / b) != a;
+    }
+    {
+        timer t("Util::Bint", "Bint", digits, "divide_small", ops);
+        for (size_t i = 0; i < ops; i++) g_sink = (b / 999999937) != b;
+    }
+    ops = digits <= 1000 ? 10 : 1;
+    Util::Bint barrett;
+    {
+        timer t("Util::Bint", "Bint", digits, "powmod", ops);
+        for (size_t i = 0; i < ops; i++) barrett = powmod(b, e, m);
+    }
+    if (digits > 30000) return;
+    Util::Bint plain;
+    {
+        timer t("Util::Bint", "Bint", digits, "powmod_remainder", ops);
+        for (size_t i = 0; i < ops; i++) {
+            // 从高位到低位的二进制快速幂,每次乘法之后取余
+            Util::Bint exponent = e, base = b % m, result = 1;
+            std::vector<int> bits;
+            while (exponent != 0) {
+                bits.push_back((exponent % 2) != 0);
+                exponent /= 2;
+            }
+            for (size_t k = bits.size(); k-- > 0;) {
+                result = result * result % m;
+                if (bits[k]) result = result * base % m;
+            }
+            plain = result;
+        }
+    }
+    g_sink = barrett != plain;
+}
+
+void run_bint_io_case(size_t digits) {
+    std::string text = random_digits(digits, 4);
+    Util::Bint a(text);
+    size_t ops = digits < 1000000 ? 1000000 / digits : 1;
+    std::vector<char> buffer(a.chars_size());
+    {
+        timer t("Util::Bint", "Bint", digits, "to_chars", ops);
+        for (size_t i = 0; i < ops; i++) g_sink = a.to_chars(buffer.data(), buffer.data() + buffer.size()) - buffer.data();
+    }
+    {
+        timer t("Util::Bint", "Bint", digits, "from_chars", ops);
+        for (size_t i = 0; i < ops; i++) g_sink = a.from_chars(text.data(), text.data() + text.size()) - text.data();
+    }
+    {
+        timer t("Util::Bint", "Bint", digits, "print", ops);
+        for (size_t i = 0; i < ops; i++) {
+            std::ostringstream os;
+            os << a;
+            g_sink = os.tellp();
+        }
+    }
+    {
+        timer t("Util::Bint", "Bint", digits, "parse", ops);
+        for (size_t i = 0; i < ops; i++) {
+            std::istringstream is(text);
+            is >> a;
+            g_sink = a != 0;
+        }
+    }
+    {
+        // 旧的输出方式:每一位经过一次流格式化
+        std::vector<unsigned> limbs;
+        for (size_t end = text.size(); end > 0; end = end >= 9 ? end - 9 : 0) {
+            limbs.push_back(static_cast<unsigned>(atoi(text.substr(end >= 9 ? end - 9 : 0, end >= 9 ? 9 : end).c_str())));
+            if (end < 9) break;
+        }
+        timer t("Util::Bint", "Bint", digits, "print_setw", ops);
+        for (size_t i = 0; i < ops; i++) {
+            std::ostringstream os;
+            os << limbs.back();
+            for (size_t k = limbs.size() - 1; k-- > 0;) os << std::setw(9) << std::setfill('0') << limbs[k];
+            g_sink = os.tellp();
+        }
+    }
+}
+
+void run_bint_kernel_case(size_t limbs) {
+    Util::Bint a(random_digits(9 * limbs, 5)), b(random_digits(9 * limbs, 6));
+    Util::Bint copy = a;
+    size_t ops = limbs <= 100000 ? 100 : limbs <= 1000000 ? 10 : 2;
+    for (int simd = 1; simd >= 0; simd--) {
+        Util::Bint::simdKernels = simd != 0;
+        Util::Bint x = a;
+        {
+            timer t("Util::Bint", "Bint", limbs, simd ? "add_simd" : "add", ops);
+            for (size_t i = 0; i < ops; i++) x += b;
+        }
+        {
+            timer t("Util::Bint", "Bint", limbs, simd ? "subtract_simd" : "subtract", ops);
+            for (size_t i = 0; i < ops; i++) x -= b;
+        }
+        {
+            timer t("Util::Bint", "Bint", limbs, simd ? "compare_simd" : "compare", ops);
+            for (size_t i = 0; i < ops; i++) g_sink = (x == copy) + (x < copy);
+        }
+    }
+    Util::Bint::simdKernels = true;
+}
+
+void run_bint_accumulate_case(size_t n) {
+    sjtu::deque<Util::Bint> values;
+    for (size_t i = 0; i < n; i++) values.push_back(Util::Bint(random_digits(100, i)));
+    Util::Bint sum;
+    {
+        timer t("Util::Bint", "Bint", n, "accumulate_copy", n);
+        for (auto it = values.cbegin(); it != values.cend(); ++it) sum = sum + *it;
+    }
+    g_sink = sum != values[0];
+    sum = 0;
+    {
+        timer t("Util::Bint", "Bint", n, "accumulate_inplace", n);
+        for (auto it = values.cbegin(); it != values.cend(); ++it) sum += *it;
+    }
+    g_sink = sum != values[0];
+}
+
+void run_bint_arena_case(size_t digits) {
+    Util::Bint a(random_digits(digits, 1)), b(random_digits(digits, 2));
+    Util::Bint c(random_digits(digits, 3)), d(random_digits(digits, 4)), r;
+    size_t ops = 10000000 / digits;
+    r = a + b * c - d; // 预热缓存
+    {
+        timer t("Util::Bint", "Bint", digits, "expression", ops);
+        for (size_t i = 0; i < ops; i++) r = a + b * c - d;
+    }
+    size_t saved = Util::Bint::arenaBytes;
+    Util::Bint::arenaBytes = 0;
+    Util::Bint::releaseArena();
+    {
+        timer t("Util::Bint", "Bint", digits, "expression_noarena", ops);
+        for (size_t i = 0; i < ops; i++) r = a + b * c - d;
+    }
+    Util::Bint::arenaBytes = saved;
+    g_sink = r != a;
+}
+
+template<class T>
+void run_fixed_values(const sjtu::deque<T> &values, const char *container, const char *type, size_t digits) {
+    const size_t rounds = 1000;
+    size_t count = values.size();
+    T sum = 0, last = 0;
+    {
+        timer t(container, type, digits, "add", rounds * count);
+        for (size_t r = 0; r < rounds; r++)
+            for (auto it = values.cbegin(); it != values.cend(); ++it) sum += *it;
+    }
+    {
+        timer t(container, type, digits, "multiply", rounds * (count - 1));
+        for (size_t r = 0; r < rounds; r++)
+            for (auto it = values.cbegin(), next = it + 1; next != values.cend(); ++it, ++next) last = *it * *next;
+    }
+    g_sink = sum != last;
+    {
+        timer t(container, type, digits, "divide", rounds * (count - 1));
+        for (size_t r = 0; r < rounds; r++)
+            for (auto it = values.cbegin(), next = it + 1; next != values.cend(); ++it, ++next) {
+                last = (*it * *next) / *next;
+            }
+    }
+    g_sink = sum != last;
+}
+
+void run_fixed_bint_case(size_t digits) {
+    sjtu::deque<Util::FixedBint<256> > fixed;
+    sjtu::deque<Util::Bint> big;
+    for (size_t i = 0; i < 1000; i++) {
+        std::string s = random_digits(digits, i);
+        fixed.push_back(Util::FixedBint<256>(s));
+        big.push_back(Util::Bint(s));
+    }
+    run_fixed_values(fixed, "Util::FixedBint", "FixedBint<256>", digits);
+    run_fixed_values(big, "Util::Bint", "Bint", digits);
+}
+
+void run_bint_threads_case(size_t digits) {
+    static const char *const ops[] = {"multiply_threads_1", "multiply_threads_2", "multiply_threads_4",
+                                      "multiply_threads_8", "multiply_threads_16"};
+    Util::Bint a(random_digits(digits, 1)), b(random_digits(digits, 2));
+    size_t count = digits < 10000000 ? 10000000 / digits : 1;
+    for (unsigned k = 0; k < 5; k++) {
+        Util::Bint::multiplyThreads = 1u << k;
+        timer t("Util::Bint", "Bint", digits, ops[k], count);
+        for (size_t i = 0; i < count; i++) g_sink = (a * b) != a;
+    }
+    Util::Bint::multiplyThreads = 1;
+}
+
+// 每个用例在子进程中运行,峰值RSS只属于该用例
+void fork_run(void (*run)(size_t), size_t n) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        run(n);
+        fflush(stdout);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+}
+
+template<class C>
+void fork_case(size_t n) {
+    fork_run(run_case<C>, n);
+}
+
+template<class T>
+void run_type(int max_exponent) {
+    size_t n = 100;
+    for (int e = 2; e <= max_exponent; e++, n *= 10) {
+        fork_case<sjtu::deque<T> >(n);
+        fork_case<std::deque<T> >(n);
+        fork_case<std::vector<T> >(n);
+        fork_case<ring_buffer<T> >(n);
+    }
+}
+
+int main(int argc, char **argv) {
+    int max_exponent = argc > 1 ? atoi(argv[1]) : 6;
+    int heavy_max_exponent = argc > 2 ? atoi(argv[2]) : 4;
+    int stream_exponent = argc > 3 ? atoi(argv[3]) : 8;
+    int multiply_exponent = argc > 4 ? atoi(argv[4]) : 6;
+    puts("container,type,n,op,ops,ns_per_op,allocs_per_op,peak_rss_kb");
+    run_type<int>(max_exponent);
+    run_type<Pod64>(max_exponent);
+    run_type<Util::Bint>(heavy_max_exponent);
+    run_type<Diamond::Matrix<double> >(heavy_max_exponent);
+    size_t n = 100;
+    for (int e = 2; e <= max_exponent; e++, n *= 10) {
+        fork_run(run_algorithm_case<int>, n);
+        fork_run(run_algorithm_case<double>, n);
+    }
+    g_stream_length = 1;
+    for (int e = 0; e < stream_exponent; e++) g_stream_length *= 10;
+    fork_run(run_monotonic_case, 16);
+    fork_run(run_monotonic_case, 1024);
+    fork_run(run_monotonic_case, 65536);
+    Util::Bint::tuneMultiply();
+    fprintf(stderr, "Bint multiply thresholds (limbs): karatsuba=%zu toom3=%zu ntt=%zu\n",
+            Util::Bint::multiplyThresholds.karatsuba, Util::Bint::multiplyThresholds.toom3,
+            Util::Bint::multiplyThresholds.ntt);
+    n = 10;
+    for (int e = 1; e <= multiply_exponent; e++, n *= 10) {
+        fork_run(run_bint_multiply_case, n);
+        if (e < multiply_exponent) fork_run(run_bint_multiply_case, 3 * n);
+    }
+    n = 1000;
+    for (int e = 3; e <= multiply_exponent; e++, n *= 10) fork_run(run_bint_io_case, n);
+    for (size_t digits = 1000; digits <= 100000; digits *= 10) {
+        fork_run(run_bint_division_case, digits);
+        if (digits < 100000) fork_run(run_bint_division_case, 3 * digits);
+    }
+    for (size_t limbs = 100000; limbs <= 10000000; limbs *= 10) fork_run(run_bint_kernel_case, limbs);
+    fork_run(run_bint_accumulate_case, 100000);
+    for (size_t digits = 100; digits <= 100000; digits *= 10) fork_run(run_bint_arena_case, digits);
+    fork_run(run_fixed_bint_case, 35);
+    fork_run(run_bint_threads_case, 1000000);
+    fork_run(run_bint_threads_case, 10000000);
+    return 0;
+}
@@ -1,16 +1,25 @@
+#ifndef UTIL_BINT_HPP
+#define UTIL_BINT_HPP
+
 #include <string>
 #include <iostream>
 #include <cstring>
 #include <cstdlib>
 #include <vector>
+#include <cstdint>
 #include <stdexcept>
 
 namespace Util {
 
-const size_t MIN_CAPACITY = 2048;
+const size_t INLINE_LIMBS = 4; // 不超过这么多位的数直接存放在对象内,任何64位整数都放得下
+
+template<size_t Bits>
+class FixedBint;
 
     // 大整数类
 class Bint {
+    template<size_t Bits>
+    friend class FixedBint;
     // 内存分配失败
     class NewSpaceFailed : public std::runtime_error {
     public:
@@ -21,18 +30,100 @@ class Bint {
     public:
         BadCast();
     };
-    bool isMinus = false; // 正负
-    size_t length; // 有效位数
-    int *data = nullptr; // 存储大整数的每一位数字
-    size_t capacity = MIN_CAPACITY; // 当前容量
-    void _DoubleSpace();
-    void _SafeNewSpace(int *&p, const size_t &len);
+    // 除数或模数为0
+    class DivideByZero : public std::domain_error {
+    public:
+        DivideByZero();
+    };
+    // powmod的指数为负
+    class NegativeExponent : public std::domain_error {
+    public:
+        NegativeExponent();
+    };
+    typedef uint32_t limb_t; // 一位,两位之和不会溢出
+    static const limb_t BASE = 1000000000; // 每一位的进制
+    static const int BASE_DIGITS = 9; // 每一位对应的十进制位数
+    bool isMinus = false; // 正负,零总是非负
+    size_t length; // 有效位数,只有前length位有意义
+    limb_t *data; // 存储大整数的每一位数字,指向small或者堆上的数组
+    size_t capacity = INLINE_LIMBS; // 当前容量
+    limb_t small[INLINE_LIMBS]; // 内联存储
+    // 堆上的数组和运算中的临时数组都从当前线程的缓存中分配,释放时先放回缓存
+    class _Arena;
+    template<class T>
+    class _ScratchAllocator;
+    template<class T>
+    using _Scratch = std::vector<T, _ScratchAllocator<T> >;
+    void _Reserve(size_t len);
+    void _Release();
+    void _Trim();
+    void _SetValue(unsigned long long x, bool minus);
+    static limb_t _AddLimbs(const limb_t *a, const limb_t *b, limb_t *r, size_t n);
+    static limb_t _SubLimbs(const limb_t *a, const limb_t *b, limb_t *r, size_t n);
+    static int _CompareLimbs(const limb_t *a, const limb_t *b, size_t n);
+    static int _CompareAbs(const Bint &lhs, const Bint &rhs);
+    static void _AddAbs(const Bint &lhs, const Bint &rhs, Bint &result);
+    static void _SubAbs(const Bint &lhs, const Bint &rhs, Bint &result);
+    static Bint _AddSigned(const Bint &lhs, const Bint &rhs, bool rhsMinus);
+    void _AddSignedInPlace(const Bint &rhs, bool rhsMinus);
+    void _AddSmall(unsigned long long magnitude, bool minus);
+
+    // 乘法:先把两个数看作多项式求卷积,最后统一进位
+    typedef long long coef_t; // 参与卷积的系数,Karatsuba/Toom-3求值后可能为负
+    typedef __int128 conv_t; // 卷积结果的系数,两位之积已经超过32位
+    static void _ConvolveSchool(const coef_t *a, size_t n, const coef_t *b, size_t m, conv_t *r);
+    static void _ConvolveKaratsuba(const coef_t *a, size_t n, const coef_t *b, size_t m, conv_t *r, coef_t limit);
+    static void _ConvolveToom3(const coef_t *a, size_t n, const coef_t *b, size_t m, conv_t *r, coef_t limit);
+    static bool _ConvolveFits(size_t m, coef_t limit, int growth);
+    static void _Convolve(const coef_t *a, size_t n, const coef_t *b, size_t m, conv_t *r, coef_t limit);
+    class _Barrier;
+    template<class F>
+    static void _RunTeam(unsigned threads, F work);
+    template<unsigned MOD, bool INVERSE>
+    static void _NTT(unsigned *a, const unsigned *roots, size_t size, size_t blocks,
+                     unsigned id, unsigned team, _Barrier &barrier);
+    template<unsigned MOD>
+    static void _ConvolveMod(const limb_t *a, size_t n, const limb_t *b, size_t m, unsigned *fa, unsigned *fb,
+                             unsigned *roots, size_t size, size_t blocks, unsigned id, unsigned team,
+                             _Barrier &barrier);
+    static void _ConvolveNTT(const limb_t *a, size_t n, const limb_t *b, size_t m, conv_t *r, unsigned threads);
+    static void _MulNTT(const Bint &lhs, const Bint &rhs, Bint &result);
+    static void _CarryOut(const conv_t *c, size_t len, Bint &result);
+    static void _MulAbs(const Bint &lhs, const Bint &rhs, Bint &result);
+
+    // 除法:|lhs| = |quotient| * |rhs| + |remainder|
+    static limb_t _DivSmall(const Bint &lhs, limb_t divisor, Bint &quotient);
+    static void _DivModAbs(const Bint &lhs, const Bint &rhs, Bint &quotient, Bint &remainder);
+    Bint _Limbs(size_t from) const;
+
+    // 十进制转换
+    void _ParseDigits(const char *first, const char *last);
+    static char *_FormatLimb(limb_t limb, char *end);
     explicit Bint(const size_t &capa);
 public:
+    // 两个乘数中较短者的位数(以BASE为进制)达到阈值时换用更快的算法
+    struct MultiplyThresholds {
+        size_t karatsuba;
+        size_t toom3;
+        size_t ntt;
+        size_t parallel; // NTT乘法拆给multiplyThreads个线程
+    };
+    static MultiplyThresholds multiplyThresholds;
+    // 大数乘法最多使用的线程数,默认为1即不创建线程
+    static unsigned multiplyThreads;
+    // 每个线程最多缓存这么多字节已释放的数组供之后的运算复用,置为0则不再缓存
+    static size_t arenaBytes;
+    // 把当前线程缓存的数组还给系统
+    static void releaseArena();
+    // 加减法和比较是否使用向量内核(CPU支持AVX2时);置为false强制使用逐位的版本
+    static bool simdKernels;
+    // 在当前机器上测出各算法的交叉点并写入multiplyThresholds,耗时约一秒
+    static void tuneMultiply();
+
     Bint();
     Bint(int x);
     Bint(long long x);
-    Bint(std::string x);
+    Bint(const std::string &x);
     Bint(const Bint &b);
     Bint(Bint &&b) noexcept;
 
@@ -41,6 +132,14 @@ public:
     Bint &operator=(const Bint &rhs);
     Bint &operator=(Bint &&rhs) noexcept;
 
+    // 原地运算,只在位数超出容量时按两倍扩容
+    Bint &operator+=(const Bint &rhs);
+    Bint &operator-=(const Bint &rhs);
+    Bint &operator*=(const Bint &rhs);
+    Bint &operator+=(long long rhs);
+    Bint &operator-=(long long rhs);
+    Bint &operator*=(long long rhs);
+
     friend Bint abs(const Bint &x);
     friend Bint abs(Bint &&x);
 
@@ -52,11 +151,36 @@ public:
     friend bool operator>=(const Bint &lhs, const Bint &rhs);
 
     friend Bint operator+(const Bint &lhs, const Bint &rhs);
+    friend Bint operator+(Bint &&lhs, const Bint &rhs);
+    friend Bint operator+(const Bint &lhs, Bint &&rhs);
+    friend Bint operator+(Bint &&lhs, Bint &&rhs);
     friend Bint operator-(const Bint &b);
     friend Bint operator-(Bint &&b);
     friend Bint operator-(const Bint &lhs, const Bint &rhs);
+    friend Bint operator-(Bint &&lhs, const Bint &rhs);
+    friend Bint operator-(const Bint &lhs, Bint &&rhs);
+    friend Bint operator-(Bint &&lhs, Bint &&rhs);
     friend Bint operator*(const Bint &lhs, const Bint &rhs);
 
+    // 除法向零取整,余数与被除数同号,与内置整数一致;除数为0时抛出DivideByZero
+    friend void divmod(const Bint &lhs, const Bint &rhs, Bint &quotient, Bint &remainder);
+    friend Bint operator/(const Bint &lhs, const Bint &rhs);
+    friend Bint operator%(const Bint &lhs, const Bint &rhs);
+    Bint &operator/=(const Bint &rhs);
+    Bint &operator%=(const Bint &rhs);
+
+    friend Bint pow(const Bint &base, unsigned long long exponent);
+    // base^exponent mod |modulus|,结果在[0, |modulus|)内;模数为0时抛出DivideByZero,指数为负时抛出NegativeExponent
+    friend Bint powmod(const Bint &base, const Bint &exponent, const Bint &modulus);
+
+    // 十进制文本的长度,包括负号
+    size_t chars_size() const;
+    // 把十进制文本写入[first, last),返回写完之后的位置;放不下时返回nullptr
+    char *to_chars(char *first, char *last) const;
+    // 从first开始读取可选的负号和尽可能多的数字,返回第一个没有读取的位置;
+    // 没有数字时返回first且不改变*this
+    const char *from_chars(const char *first, const char *last);
+
     friend std::istream &operator>>(std::istream &is, Bint &b);
     friend std::ostream &operator<<(std::ostream &os, const Bint &b);
 
@@ -64,168 +188,307 @@ public:
 };
 }
 
-#include <iomanip>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define UTIL_BINT_SIMD_X86
+#include <immintrin.h>
+#endif
 
 namespace Util {
 
 Bint::NewSpaceFailed::NewSpaceFailed() : std::runtime_error("No Enough Memory Space.") {}
 Bint::BadCast::BadCast() : std::invalid_argument("Cannot convert to a Bint object") {}
+Bint::DivideByZero::DivideByZero() : std::domain_error("Division by zero") {}
+Bint::NegativeExponent::NegativeExponent() : std::domain_error("Negative exponent") {}
 
-void Bint::_SafeNewSpace(int *&p, const size_t &len)
+// 按2的幂字节数分级的后进先出缓存,同一级的空闲块用块开头的指针串成链表.
+// 不超过2^MAX_SHIFT字节的请求向上取整到所在的级,释放时按同样的级归还;
+// 线程结束时缓存还给系统,之后在该线程上的释放直接还给系统
+class Bint::_Arena
 {
-    if (p != nullptr) {
-        delete[] p;
-        p = nullptr;
+public:
+    // 分配至少bytes字节并把bytes改为实际大小,失败时返回nullptr
+    static void *allocate(size_t &bytes) noexcept
+    {
+        if (bytes <= MAX_BYTES) {
+            int shift = _Shift(bytes);
+            bytes = static_cast<size_t>(1) << shift;
+            void *block = cache.heads[shift];
+            if (block != nullptr) {
+                cache.heads[shift] = *static_cast<void **>(block);
+                cache.bytes -= bytes;
+                return block;
+            }
+        }
+        return ::operator new(bytes, std::nothrow);
     }
-    p = new int[len];
-    if (p == nullptr) {
-        throw NewSpaceFailed();
+
+    // bytes可以是申请时的大小,也可以是allocate()改过的大小
+    static void release(void *block, size_t bytes) noexcept
+    {
+        if (bytes <= MAX_BYTES && !cache.closed) {
+            int shift = _Shift(bytes);
+            bytes = static_cast<size_t>(1) << shift;
+            if (cache.bytes + bytes <= arenaBytes) {
+                static thread_local Guard guard;
+                (void)guard;
+                *static_cast<void **>(block) = cache.heads[shift];
+                cache.heads[shift] = block;
+                cache.bytes += bytes;
+                return;
+            }
+        }
+        ::operator delete(block);
+    }
+
+    static void clear() noexcept
+    {
+        for (int shift = MIN_SHIFT; shift <= MAX_SHIFT; ++shift) {
+            while (cache.heads[shift] != nullptr) {
+                void *next = *static_cast<void **>(cache.heads[shift]);
+                ::operator delete(cache.heads[shift]);
+                cache.heads[shift] = next;
+            }
+        }
+        cache.bytes = 0;
     }
-    memset(p, 0, len * sizeof(unsigned int));
+
+private:
+    static const int MIN_SHIFT = 4, MAX_SHIFT = 24;
+    static const size_t MAX_BYTES = static_cast<size_t>(1) << MAX_SHIFT;
+
+    // 平凡类型,线程结束之前始终可以访问
+    struct Cache {
+        void *heads[MAX_SHIFT + 1];
+        size_t bytes; // 缓存的总字节数
+        bool closed;
+    };
+
+    struct Guard {
+        ~Guard()
+        {
+            clear();
+            cache.closed = true;
+        }
+    };
+
+    static thread_local Cache cache;
+
+    static int _Shift(size_t bytes)
+    {
+        int shift = MIN_SHIFT;
+        while ((static_cast<size_t>(1) << shift) < bytes) {
+            ++shift;
+        }
+        return shift;
+    }
+};
+
+thread_local Bint::_Arena::Cache Bint::_Arena::cache;
+size_t Bint::arenaBytes = static_cast<size_t>(1) << 22;
+
+void Bint::releaseArena()
+{
+    _Arena::clear();
 }
 
-void Bint::_DoubleSpace()
+// 让std::vector从_Arena分配运算中的临时数组
+template<class T>
+class Bint::_ScratchAllocator
 {
-    int *newMem = nullptr;
-    _SafeNewSpace(newMem, capacity << 1);
-    memcpy(newMem, data, capacity * sizeof(int));
-    delete[] data;
+public:
+    typedef T value_type;
+
+    _ScratchAllocator() = default;
+
+    template<class U>
+    _ScratchAllocator(const _ScratchAllocator<U> &) {}
+
+    T *allocate(size_t n)
+    {
+        size_t bytes = n * sizeof(T);
+        void *block = _Arena::allocate(bytes);
+        if (block == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T *>(block);
+    }
+
+    void deallocate(T *p, size_t n) noexcept
+    {
+        _Arena::release(p, n * sizeof(T));
+    }
+
+    template<class U>
+    bool operator==(const _ScratchAllocator<U> &) const
+    {
+        return true;
+    }
+
+    template<class U>
+    bool operator!=(const _ScratchAllocator<U> &) const
+    {
+        return false;
+    }
+};
+
+// 保证至少能存放len位,保留前length位;容量按两倍增长,再取整到_Arena的分级
+void Bint::_Reserve(size_t len)
+{
+    if (len <= capacity) {
+        return;
+    }
+    size_t bytes = std::max(len, capacity << 1) * sizeof(limb_t);
+    limb_t *newMem = static_cast<limb_t *>(_Arena::allocate(bytes));
+    if (newMem == nullptr) {
+        throw NewSpaceFailed();
+    }
+    memcpy(newMem, data, length * sizeof(limb_t));
+    _Release();
     data = newMem;
-    capacity <<= 1;
+    capacity = bytes / sizeof(limb_t);
 }
 
-Bint::Bint()
-    : length(1)
+// 释放堆上的数组,回到内联存储
+void Bint::_Release()
 {
-    _SafeNewSpace(data, capacity);
+    if (data != small) {
+        _Arena::release(data, capacity * sizeof(limb_t));
+        data = small;
+        capacity = INLINE_LIMBS;
+    }
 }
 
-Bint::Bint(int x)
-    : length(0)
+// 去掉最高位的0;结果为0时去掉负号
+void Bint::_Trim()
 {
-    _SafeNewSpace(data, capacity);
-    if (x < 0) {
-        isMinus = true;
-        x = -x;
-    }
-    while (x) {
-        data[length++] = x % 10000;
-        x /= 10000;
+    while (length > 1 && data[length - 1] == 0) {
+        --length;
     }
-    if (!length) {
-        length = 1;
+    if (length == 1 && data[0] == 0) {
+        isMinus = false;
     }
 }
 
-Bint::Bint(long long x)
-    : length(0)
+void Bint::_SetValue(unsigned long long x, bool minus)
 {
-    _SafeNewSpace(data, capacity);
-    if (x < 0) {
-        isMinus = true;
-        x = -x;
-    }
+    length = 0;
     while (x) {
-        data[length++] = static_cast<unsigned int>(x % 10000);
-        x /= 10000;
+        data[length++] = static_cast<limb_t>(x % BASE);
+        x /= BASE;
     }
     if (!length) {
-        length = 1;
+        data[length++] = 0;
     }
+    isMinus = minus && (length > 1 || data[0] != 0);
 }
 
-Bint::Bint(const size_t &capa)
-    : length(1)
+Bint::Bint()
+    : length(1), data(small)
 {
-    while (capacity < capa) {
-        capacity <<= 1;
-    }
-    _SafeNewSpace(data, capacity);
+    data[0] = 0;
 }
 
-Bint::Bint(std::string x)
+Bint::Bint(int x)
+    : Bint(static_cast<long long>(x))
 {
-    while (x[0] == '-') {
-        isMinus = !isMinus;
-        x.erase(0, 1);
-    }
-    while ((capacity << 2) <= x.length()) {
-        capacity <<= 1;
-    }
+}
+
+Bint::Bint(long long x)
+    : data(small)
+{
+    // 先转成无符号数再取反,LLONG_MIN也不会溢出
+    unsigned long long magnitude = static_cast<unsigned long long>(x);
+    _SetValue(x < 0 ? 0 - magnitude : magnitude, x < 0);
+}
 
-    _SafeNewSpace(data, capacity);
+Bint::Bint(const size_t &capa)
+    : length(1), data(small)
+{
+    _Reserve(capa);
+    data[0] = 0;
+}
 
-    size_t mid = x.length() >> 1;
-    for (size_t i = 0; i < mid; ++i) {
-        std::swap(x[i], x[x.length() - 1 - i]);
+// [first, last)全是数字且非空;从最低位开始,每BASE_DIGITS个字符组成一位
+void Bint::_ParseDigits(const char *first, const char *last)
+{
+    length = 0;
+    _Reserve((last - first + BASE_DIGITS - 1) / BASE_DIGITS);
+    while (last != first) {
+        const char *start = last - first >= BASE_DIGITS ? last - BASE_DIGITS : first;
+        limb_t limb = 0;
+        for (const char *p = start; p != last; ++p) {
+            limb = limb * 10 + static_cast<limb_t>(*p - '0');
+        }
+        data[length++] = limb;
+        last = start;
     }
+    _Trim();
+}
 
-    const static unsigned int pow10[4] = {1, 10, 100, 1000};
-    for (size_t i = 0; i < capacity; ++i) {
-        if ((i << 2) >= x.length()) {
-            length = i;
-            break;
-        }
-        for (size_t j = 0; j < 4; ++j) {
-            if ((i << 2) + j >= x.length()) {
-                break;
-            }
-            if (x[(i << 2) + j] > '9' || x[(i << 2) + j] < '0') {
-                throw BadCast();
-            }
-            data[i] = data[i] + (x[(i << 2) + j] - '0') * pow10[j];
+Bint::Bint(const std::string &x)
+    : length(1), data(small)
+{
+    data[0] = 0;
+    size_t begin = 0;
+    bool minus = false;
+    while (begin < x.length() && x[begin] == '-') {
+        minus = !minus;
+        ++begin;
+    }
+    if (begin == x.length()) {
+        throw BadCast();
+    }
+    for (size_t i = begin; i < x.length(); ++i) {
+        if (x[i] > '9' || x[i] < '0') {
+            throw BadCast();
         }
     }
+    isMinus = minus;
+    _ParseDigits(x.data() + begin, x.data() + x.length());
 }
 
 Bint::Bint(const Bint &b)
-    : isMinus(b.isMinus), length(b.length), capacity(b.capacity)
+    : isMinus(b.isMinus), length(0), data(small)
 {
-    _SafeNewSpace(data, capacity);
-    memcpy(data, b.data, sizeof(unsigned int) * capacity);
+    _Reserve(b.length);
+    memcpy(data, b.data, sizeof(limb_t) * b.length);
+    length = b.length;
 }
 
 Bint::Bint(Bint &&b) noexcept
-    : isMinus(b.isMinus), length(b.length), capacity(b.capacity)
+    : isMinus(b.isMinus), length(b.length), data(small)
 {
-    data = b.data;
-    b.data = nullptr;
+    if (b.data == b.small) {
+        memcpy(small, b.small, sizeof(limb_t) * length);
+    } else {
+        data = b.data;
+        capacity = b.capacity;
+        // 被移走的对象变为0
+        b.data = b.small;
+        b.capacity = INLINE_LIMBS;
+    }
+    b.length = 1;
+    b.data[0] = 0;
+    b.isMinus = false;
 }
 
 Bint &Bint::operator=(int x)
 {
-    memset(data, 0, sizeof(unsigned int) * capacity);
-    length = 0;
-    if (x < 0) {
-        isMinus = true;
-        x = -x;
-    }
-    while (x) {
-        data[length++] = x % 10000;
-        x /= 10000;
-    }
-    if (!length) {
-        length = 1;
-    }
-    return *this;
+    return *this = static_cast<long long>(x);
 }
 
 Bint &Bint::operator=(long long x)
 {
-    memset(data, 0, sizeof(unsigned int) * capacity);
-    length = 0;
-    if (x < 0) {
-        isMinus = true;
-        x = -x;
-    }
-    while (x) {
-        data[length++] = static_cast<unsigned int>(x % 10000);
-        x /= 10000;
-    }
-    if (!length) {
-        length = 1;
-    }
+    unsigned long long magnitude = static_cast<unsigned long long>(x);
+    _SetValue(x < 0 ? 0 - magnitude : magnitude, x < 0);
     return *this;
 }
 
@@ -234,11 +497,12 @@ Bint &Bint::operator=(const Bint &rhs)
     if (this == &rhs) {
         return *this;
     }
-    if (rhs.capacity > capacity) {
-        capacity = rhs.capacity;
-        _SafeNewSpace(data, capacity);
+    if (rhs.length > capacity) {
+        // 旧的内容不需要保留
+        length = 0;
+        _Reserve(rhs.length);
     }
-    memcpy(data, rhs.data, sizeof(unsigned int) * rhs.capacity);
+    memcpy(data, rhs.data, sizeof(limb_t) * rhs.length);
     length = rhs.length;
     isMinus = rhs.isMinus;
     return *this;
@@ -249,35 +513,176 @@ Bint &Bint::operator=(Bint &&rhs) noexcept
     if (this == &rhs) {
         return *this;
     }
-    capacity = rhs.capacity;
+    if (rhs.data == rhs.small) {
+        memcpy(data, rhs.small, sizeof(limb_t) * rhs.length);
+    } else {
+        _Release();
+        data = rhs.data;
+        capacity = rhs.capacity;
+        rhs.data = rhs.small;
+        rhs.capacity = INLINE_LIMBS;
+    }
     length = rhs.length;
     isMinus = rhs.isMinus;
-    data = rhs.data;
-    rhs.data = nullptr;
+    rhs.length = 1;
+    rhs.data[0] = 0;
+    rhs.isMinus = false;
     return *this;
 }
 
+size_t Bint::chars_size() const
+{
+    size_t digits = 1;
+    for (limb_t top = data[length - 1]; top >= 10; top /= 10) {
+        ++digits;
+    }
+    return isMinus + digits + (length - 1) * BASE_DIGITS;
+}
+
+// 把一位写成BASE_DIGITS个字符(含前导0),结束于end,返回开始的位置;每次查表写两个字符
+char *Bint::_FormatLimb(limb_t limb, char *end)
+{
+    static const char pairs[] =
+        "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+        "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+    for (int i = 0; i < BASE_DIGITS / 2; ++i) {
+        limb_t pair = limb % 100;
+        limb /= 100;
+        *--end = pairs[2 * pair + 1];
+        *--end = pairs[2 * pair];
+    }
+    *--end = static_cast<char>('0' + limb);
+    return end;
+}
+
+char *Bint::to_chars(char *first, char *last) const
+{
+    size_t size = chars_size();
+    if (static_cast<size_t>(last - first) < size) {
+        return nullptr;
+    }
+    char *end = first + size;
+    char *p = end;
+    for (size_t i = 0; i + 1 < length; ++i) {
+        p = _FormatLimb(data[i], p);
+    }
+    limb_t top = data[length - 1];
+    do {
+        *--p = static_cast<char>('0' + top % 10);
+        top /= 10;
+    } while (top);
+    if (isMinus) {
+        *--p = '-';
+    }
+    return end;
+}
+
+const char *Bint::from_chars(const char *first, const char *last)
+{
+    const char *begin = first;
+    bool minus = false;
+    while (begin != last && *begin == '-') {
+        minus = !minus;
+        ++begin;
+    }
+    const char *end = begin;
+    while (end != last && *end >= '0' && *end <= '9') {
+        ++end;
+    }
+    if (end == begin) {
+        return first;
+    }
+    isMinus = minus;
+    _ParseDigits(begin, end);
+    return end;
+}
+
+// 直接从流缓冲区读取:数字按读到的顺序每BASE_DIGITS个一组存入b,
+// 读完之后按总位数重新对齐到最低位,再把顺序颠倒过来,不经过中间字符串
 std::istream &operator>>(std::istream &is, Bint &b)
 {
-    std::string s;
-    is >> s;
-    b = Bint(s);
+    std::istream::sentry sentry(is);
+    if (!sentry) {
+        return is;
+    }
+    std::streambuf *buf = is.rdbuf();
+    typedef std::char_traits<char> traits;
+    traits::int_type c = buf->sgetc();
+    bool minus = false;
+    while (!traits::eq_int_type(c, traits::eof()) && traits::to_char_type(c) == '-') {
+        minus = !minus;
+        c = buf->snextc();
+    }
+    if (traits::eq_int_type(c, traits::eof()) || traits::to_char_type(c) < '0' || traits::to_char_type(c) > '9') {
+        is.setstate(traits::eq_int_type(c, traits::eof()) ? std::ios::failbit | std::ios::eofbit : std::ios::failbit);
+        return is;
+    }
+
+    b.length = 0;
+    Bint::limb_t chunk = 0;
+    int chunkDigits = 0;
+    for (;;) {
+        if (traits::eq_int_type(c, traits::eof())) {
+            is.setstate(std::ios::eofbit);
+            break;
+        }
+        char ch = traits::to_char_type(c);
+        if (ch < '0' || ch > '9') {
+            break;
+        }
+        chunk = chunk * 10 + static_cast<Bint::limb_t>(ch - '0');
+        if (++chunkDigits == Bint::BASE_DIGITS) {
+            b._Reserve(b.length + 1);
+            b.data[b.length++] = chunk;
+            chunk = 0;
+            chunkDigits = 0;
+        }
+        c = buf->snextc();
+    }
+
+    // 末尾不满一组的r位数字使整体错开:新的每一组由前一组的低BASE_DIGITS - r位和本组的高r位拼成
+    size_t count = b.length;
+    if (chunkDigits) {
+        Bint::limb_t low = 1, high = 1; // 10^(BASE_DIGITS - r), 10^r
+        for (int i = 0; i < Bint::BASE_DIGITS - chunkDigits; ++i) {
+            low *= 10;
+        }
+        for (int i = 0; i < chunkDigits; ++i) {
+            high *= 10;
+        }
+        b._Reserve(count + 1);
+        Bint::limb_t next = chunk;
+        for (size_t i = count; i-- > 0; ) {
+            Bint::limb_t cur = b.data[i];
+            b.data[i + 1] = cur % low * high + next;
+            next = cur / low;
+        }
+        b.data[0] = next;
+        ++count;
+    }
+    std::reverse(b.data, b.data + count);
+    b.length = count;
+    b.isMinus = minus;
+    b._Trim();
     return is;
 }
 
 std::ostream &operator<<(std::ostream &os, const Bint &b)
 {
-    if (b.data == nullptr) {
-        return os;
-    }
-    if (b.isMinus && (b.length > 1 || b.data[0] != 0)) {
-        os << "-";
+    char stackBuffer[64];
+    std::vector<char> heapBuffer;
+    size_t size = b.chars_size();
+    char *first = stackBuffer;
+    if (size > sizeof(stackBuffer)) {
+        heapBuffer.resize(size);
+        first = heapBuffer.data();
     }
-    os << b.data[b.length - 1];
-    for (long long i = b.length - 2LL; i >= 0; --i) {
-        os << std::setw(4) << std::setfill('0') << b.data[i];
+    char *last = b.to_chars(first, first + size);
+    // 设置了宽度时交给流去填充
+    if (os.width() > 0) {
+        return os << std::string(first, last);
     }
-    return os;
+    return os.write(first, last - first);
 }
 
 Bint abs(const Bint &b)
@@ -290,230 +695,1199 @@ Bint abs(const Bint &b)
 Bint abs(Bint &&b)
 {
     b.isMinus = false;
-    return b;
+    return std::move(b);
 }
 
-bool operator==(const Bint &lhs, const Bint &rhs)
+bool Bint::simdKernels = true;
+
+#ifdef UTIL_BINT_SIMD_X86
+/*
+ * AVX2的逐位加减和比较,每次处理8位.所有位都小于base < 2^31,可以当作有符号数比较.
+ * 加法:各位先分别相加,s >= base的位一定向上进位(generate),s == base - 1的位
+ * 在有进位进来时才向上进位(propagate).把两者取成8位的掩码G、P,
+ * 令X = G << 1 | 进来的进位,则各位收到的进位为((X + P) ^ P) | X,第8位就是向下一组的进位.
+ * 减法同理:a < b的位产生借位,a == b的位传递借位.
+ */
+inline bool bint_has_avx2()
 {
-    if (lhs.isMinus != rhs.isMinus) {
-        return false;
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+
+__attribute__((target("avx2"))) inline uint32_t bint_add_avx2(const uint32_t *a, const uint32_t *b, uint32_t *r,
+                                                              size_t n, uint32_t base)
+{
+    const __m256i vbase = _mm256_set1_epi32(static_cast<int>(base));
+    const __m256i vtop = _mm256_set1_epi32(static_cast<int>(base - 1));
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    unsigned carry = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i sum = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+        unsigned g = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(sum, vtop))));
+        unsigned p = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(sum, vtop))));
+        unsigned x = g << 1 | carry;
+        unsigned c = ((x + p) ^ p) | x;
+        carry = c >> 8;
+        // 收到进位的位加一(减去全1),再把不小于base的位减去base
+        __m256i in = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(c)), lanes), lanes);
+        sum = _mm256_sub_epi32(sum, in);
+        sum = _mm256_sub_epi32(sum, _mm256_and_si256(_mm256_cmpgt_epi32(sum, vtop), vbase));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(r + i), sum);
     }
-    if (lhs.length != rhs.length) {
-        return false;
+    for (; i < n; ++i) {
+        uint32_t sum = a[i] + b[i] + carry;
+        carry = sum >= base;
+        r[i] = carry ? sum - base : sum;
+    }
+    return carry;
+}
+
+__attribute__((target("avx2"))) inline uint32_t bint_sub_avx2(const uint32_t *a, const uint32_t *b, uint32_t *r,
+                                                              size_t n, uint32_t base)
+{
+    const __m256i vbase = _mm256_set1_epi32(static_cast<int>(base));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    unsigned borrow = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        unsigned g = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(vb, va))));
+        unsigned p = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, vb))));
+        unsigned x = g << 1 | borrow;
+        unsigned c = ((x + p) ^ p) | x;
+        borrow = c >> 8;
+        // 收到借位的位减一(加上全1),再把负的位加上base
+        __m256i in = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(c)), lanes), lanes);
+        __m256i diff = _mm256_add_epi32(_mm256_sub_epi32(va, vb), in);
+        diff = _mm256_add_epi32(diff, _mm256_and_si256(_mm256_cmpgt_epi32(zero, diff), vbase));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(r + i), diff);
+    }
+    for (; i < n; ++i) {
+        uint32_t subtrahend = b[i] + borrow;
+        borrow = a[i] < subtrahend;
+        r[i] = borrow ? a[i] + (base - subtrahend) : a[i] - subtrahend;
     }
-    for (size_t i = 0; i < lhs.length; ++i) {
-        if (lhs.data[i] != rhs.data[i]) {
-            return false;
+    return borrow;
+}
+
+// 从最高位往下每次比较8位,找到第一组不相等的位之后用掩码定位最高的不同位
+__attribute__((target("avx2"))) inline int bint_compare_avx2(const uint32_t *a, const uint32_t *b, size_t n)
+{
+    size_t i = n;
+    for (; i >= 8; i -= 8) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i - 8));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i - 8));
+        unsigned same = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, vb))));
+        if (same != 0xff) {
+            size_t k = i - 8 + (31 - __builtin_clz(~same & 0xff));
+            return a[k] < b[k] ? -1 : 1;
+        }
+    }
+    while (i-- > 0) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
         }
     }
-    return true;
+    return 0;
 }
+#endif
 
-bool operator!=(const Bint &lhs, const Bint &rhs)
+// r[0, n) = a + b,返回向上的进位;r可以与a或b是同一个数组
+Bint::limb_t Bint::_AddLimbs(const limb_t *a, const limb_t *b, limb_t *r, size_t n)
 {
-    if (lhs.isMinus != rhs.isMinus) {
-        return true;
+#ifdef UTIL_BINT_SIMD_X86
+    if (n >= 16 && simdKernels && bint_has_avx2()) {
+        return bint_add_avx2(a, b, r, n, BASE);
     }
-    if (lhs.length != rhs.length) {
-        return true;
+#endif
+    limb_t carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+        limb_t sum = a[i] + b[i] + carry;
+        carry = sum >= BASE;
+        r[i] = carry ? sum - BASE : sum;
+    }
+    return carry;
+}
+
+// r[0, n) = a - b,返回向上的借位;r可以与a或b是同一个数组
+Bint::limb_t Bint::_SubLimbs(const limb_t *a, const limb_t *b, limb_t *r, size_t n)
+{
+#ifdef UTIL_BINT_SIMD_X86
+    if (n >= 16 && simdKernels && bint_has_avx2()) {
+        return bint_sub_avx2(a, b, r, n, BASE);
     }
-    for (size_t i = 0; i < lhs.length; ++i) {
-        if (lhs.data[i] != rhs.data[i]) {
-            return true;
+#endif
+    limb_t borrow = 0;
+    for (size_t i = 0; i < n; ++i) {
+        limb_t subtrahend = b[i] + borrow;
+        borrow = a[i] < subtrahend;
+        r[i] = borrow ? a[i] + (BASE - subtrahend) : a[i] - subtrahend;
+    }
+    return borrow;
+}
+
+// 比较两个n位的数组,返回-1,0,1
+int Bint::_CompareLimbs(const limb_t *a, const limb_t *b, size_t n)
+{
+#ifdef UTIL_BINT_SIMD_X86
+    if (n >= 16 && simdKernels && bint_has_avx2()) {
+        return bint_compare_avx2(a, b, n);
+    }
+#endif
+    for (size_t i = n; i-- > 0; ) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
         }
     }
-    return false;
+    return 0;
+}
+
+// 比较绝对值,返回-1,0,1
+int Bint::_CompareAbs(const Bint &lhs, const Bint &rhs)
+{
+    if (lhs.length != rhs.length) {
+        return lhs.length < rhs.length ? -1 : 1;
+    }
+    return _CompareLimbs(lhs.data, rhs.data, lhs.length);
+}
+
+bool operator==(const Bint &lhs, const Bint &rhs)
+{
+    return lhs.isMinus == rhs.isMinus && Bint::_CompareAbs(lhs, rhs) == 0;
+}
+
+bool operator!=(const Bint &lhs, const Bint &rhs)
+{
+    return !(lhs == rhs);
 }
 
 bool operator<(const Bint &lhs, const Bint &rhs)
 {
     if (lhs.isMinus != rhs.isMinus) {
-        return !lhs.isMinus;
+        return lhs.isMinus;
     }
-    if (lhs.isMinus) {
-        if (lhs.length != rhs.length) {
-            return lhs.length > rhs.length;
-        }
-        for (long long i = lhs.length - 1; i >= 0; --i) {
-            if (lhs.data[i] != rhs.data[i]) {
-                return lhs.data[i] > rhs.data[i];
+    int cmp = Bint::_CompareAbs(lhs, rhs);
+    return lhs.isMinus ? cmp > 0 : cmp < 0;
+}
+
+bool operator>(const Bint &lhs, const Bint &rhs)
+{
+    return rhs < lhs;
+}
+
+bool operator<=(const Bint &lhs, const Bint &rhs)
+{
+    return !(rhs < lhs);
+}
+
+bool operator>=(const Bint &lhs, const Bint &rhs)
+{
+    return !(lhs < rhs);
+}
+
+// |result| = |lhs| + |rhs|,result的容量至少为较长者加一,可以与lhs或rhs是同一个对象
+void Bint::_AddAbs(const Bint &lhs, const Bint &rhs, Bint &result)
+{
+    const Bint &longer = lhs.length >= rhs.length ? lhs : rhs;
+    const Bint &shorter = lhs.length >= rhs.length ? rhs : lhs;
+    size_t maxLen = longer.length;
+    limb_t carry = _AddLimbs(longer.data, shorter.data, result.data, shorter.length);
+    // 较长者多出来的部分只需传递进位,进位消失之后直接复制
+    size_t i = shorter.length;
+    for (; i < maxLen && carry; ++i) {
+        carry = longer.data[i] == BASE - 1;
+        result.data[i] = carry ? 0 : longer.data[i] + 1;
+    }
+    if (i < maxLen && result.data != longer.data) {
+        memcpy(result.data + i, longer.data + i, sizeof(limb_t) * (maxLen - i));
+    }
+    result.length = maxLen;
+    if (carry) {
+        result.data[result.length++] = carry;
+    }
+}
+
+// |result| = |lhs| - |rhs|,要求|lhs| >= |rhs|,result的容量至少为lhs的位数
+void Bint::_SubAbs(const Bint &lhs, const Bint &rhs, Bint &result)
+{
+    limb_t borrow = _SubLimbs(lhs.data, rhs.data, result.data, rhs.length);
+    size_t i = rhs.length;
+    for (; i < lhs.length && borrow; ++i) {
+        borrow = lhs.data[i] == 0;
+        result.data[i] = borrow ? BASE - 1 : lhs.data[i] - 1;
+    }
+    if (i < lhs.length && result.data != lhs.data) {
+        memcpy(result.data + i, lhs.data + i, sizeof(limb_t) * (lhs.length - i));
+    }
+    result.length = lhs.length;
+    result._Trim();
+}
+
+// lhs + rhs,把rhs的符号当作rhsMinus;减法就是翻转rhs的符号
+Bint Bint::_AddSigned(const Bint &lhs, const Bint &rhs, bool rhsMinus)
+{
+    if (lhs.isMinus == rhsMinus) {
+        Bint result(std::max(lhs.length, rhs.length) + 1); // special constructor
+        _AddAbs(lhs, rhs, result);
+        result.isMinus = lhs.isMinus;
+        return result;
+    }
+    if (_CompareAbs(lhs, rhs) >= 0) {
+        Bint result(lhs.length);
+        result.isMinus = lhs.isMinus;
+        _SubAbs(lhs, rhs, result);
+        return result;
+    }
+    Bint result(rhs.length);
+    result.isMinus = rhsMinus;
+    _SubAbs(rhs, lhs, result);
+    return result;
+}
+
+Bint operator+(const Bint &lhs, const Bint &rhs)
+{
+    return Bint::_AddSigned(lhs, rhs, rhs.isMinus);
+}
+
+Bint operator-(const Bint &b)
+{
+    Bint result(b);
+    result.isMinus = !result.isMinus;
+    result._Trim();
+    return result;
+}
+
+Bint operator-(Bint &&b)
+{
+    b.isMinus = !b.isMinus;
+    b._Trim();
+    return std::move(b);
+}
+
+Bint operator-(const Bint &lhs, const Bint &rhs)
+{
+    return Bint::_AddSigned(lhs, rhs, !rhs.isMinus);
+}
+
+// *this += rhs,把rhs的符号当作rhsMinus;rhs可以就是*this
+void Bint::_AddSignedInPlace(const Bint &rhs, bool rhsMinus)
+{
+    if (isMinus == rhsMinus) {
+        _Reserve(std::max(length, rhs.length) + 1);
+        _AddAbs(*this, rhs, *this);
+    } else if (_CompareAbs(*this, rhs) >= 0) {
+        _SubAbs(*this, rhs, *this);
+    } else {
+        _Reserve(rhs.length);
+        isMinus = rhsMinus;
+        _SubAbs(rhs, *this, *this);
+    }
+}
+
+// *this += (minus ? -magnitude : magnitude),从最低位开始进位或借位,通常只改动一两位
+void Bint::_AddSmall(unsigned long long magnitude, bool minus)
+{
+    if (magnitude == 0) {
+        return;
+    }
+    bool isZero = length == 1 && data[0] == 0;
+    if (isMinus == minus || isZero) {
+        isMinus = minus;
+        // magnitude < 2^64 - BASE,加上一位不会溢出
+        unsigned long long carry = magnitude;
+        for (size_t i = 0; carry; ++i) {
+            if (i == length) {
+                _Reserve(length + 1);
+                data[length++] = 0;
             }
+            carry += data[i];
+            data[i] = static_cast<limb_t>(carry % BASE);
+            carry /= BASE;
         }
-        return false;
-    } else {
-        if (lhs.length != rhs.length) {
-            return lhs.length < rhs.length;
+        return;
+    }
+    // 符号相反:绝对值不小于magnitude时逐位借位,否则结果就是magnitude - |*this|
+    if (length <= 3) {
+        unsigned __int128 value = 0;
+        for (size_t i = length; i-- > 0; ) {
+            value = value * BASE + data[i];
         }
-        for (long long i = lhs.length - 1; i >= 0; --i) {
-            if (lhs.data[i] != rhs.data[i]) {
-                return lhs.data[i] < rhs.data[i];
-            }
+        if (value < magnitude) {
+            _SetValue(magnitude - static_cast<unsigned long long>(value), minus);
+            return;
         }
-        return false;
     }
+    unsigned long long borrow = magnitude;
+    for (size_t i = 0; borrow; ++i) {
+        limb_t part = static_cast<limb_t>(borrow % BASE);
+        borrow /= BASE;
+        if (data[i] >= part) {
+            data[i] -= part;
+        } else {
+            data[i] += BASE - part;
+            ++borrow;
+        }
+    }
+    _Trim();
 }
 
-bool operator>(const Bint &lhs, const Bint &rhs)
+Bint &Bint::operator+=(const Bint &rhs)
 {
-    return rhs < lhs;
+    _AddSignedInPlace(rhs, rhs.isMinus);
+    return *this;
 }
 
-bool operator<=(const Bint &lhs, const Bint &rhs)
+Bint &Bint::operator-=(const Bint &rhs)
 {
-    if (lhs.isMinus != rhs.isMinus) {
-        return !lhs.isMinus;
+    _AddSignedInPlace(rhs, !rhs.isMinus);
+    return *this;
+}
+
+Bint &Bint::operator+=(long long rhs)
+{
+    unsigned long long magnitude = static_cast<unsigned long long>(rhs);
+    _AddSmall(rhs < 0 ? 0 - magnitude : magnitude, rhs < 0);
+    return *this;
+}
+
+Bint &Bint::operator-=(long long rhs)
+{
+    unsigned long long magnitude = static_cast<unsigned long long>(rhs);
+    _AddSmall(rhs < 0 ? 0 - magnitude : magnitude, rhs > 0);
+    return *this;
+}
+
+// 右值参与加减时直接在它的数组上计算,不再分配结果
+Bint operator+(Bint &&lhs, const Bint &rhs)
+{
+    lhs += rhs;
+    return std::move(lhs);
+}
+
+Bint operator+(const Bint &lhs, Bint &&rhs)
+{
+    rhs += lhs;
+    return std::move(rhs);
+}
+
+Bint operator+(Bint &&lhs, Bint &&rhs)
+{
+    lhs += rhs;
+    return std::move(lhs);
+}
+
+Bint operator-(Bint &&lhs, const Bint &rhs)
+{
+    lhs -= rhs;
+    return std::move(lhs);
+}
+
+// lhs - rhs = -(rhs - lhs)
+Bint operator-(const Bint &lhs, Bint &&rhs)
+{
+    rhs -= lhs;
+    rhs.isMinus = !rhs.isMinus;
+    rhs._Trim();
+    return std::move(rhs);
+}
+
+Bint operator-(Bint &&lhs, Bint &&rhs)
+{
+    lhs -= rhs;
+    return std::move(lhs);
+}
+
+// 默认值由tuneMultiply()在x86-64上测得
+Bint::MultiplyThresholds Bint::multiplyThresholds = {64, 64, 4096, 16384};
+unsigned Bint::multiplyThreads = 1;
+
+// r[0, n + m - 1) = a * b,逐项累加
+void Bint::_ConvolveSchool(const coef_t *a, size_t n, const coef_t *b, size_t m, conv_t *r)
+{
+    std::fill(r, r + n + m - 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        conv_t x = a[i];
+        for (size_t j = 0; j < m; ++j) {
+            r[i + j] += x * b[j];
+        }
+    }
+}
+
+// 要求n >= m > n / 2.a = a0 + a1 x^h,三次递归乘法代替四次;limit是a、b系数绝对值的上界
+void Bint::_ConvolveKaratsuba(const coef_t *a, size_t n, const coef_t *b, size_t m, conv_t *r, coef_t limit)
+{
+    size_t h = n >> 1;
+    size_t la = n - h, lb = std::max(h, m - h);
+    _Scratch<coef_t> sa(a + h, a + n), sb(lb, 0);
+    for (size_t i = 0; i < h; ++i) {
+        sa[i] += a[i];
+        sb[i] += b[i];
+    }
+    for (size_t i = h; i < m; ++i) {
+        sb[i - h] += b[i];
+    }
+    _Scratch<conv_t> z0(2 * h - 1), z1(la + lb - 1), z2(n + m - 2 * h - 1);
+    _Convolve(a, h, b, h, z0.data(), limit);
+    _Convolve(a + h, la, b + h, m - h, z2.data(), limit);
+    _Convolve(sa.data(), la, sb.data(), lb, z1.data(), 2 * limit);
+    for (size_t i = 0; i < z0.size(); ++i) {
+        z1[i] -= z0[i];
+    }
+    for (size_t i = 0; i < z2.size(); ++i) {
+        z1[i] -= z2[i];
     }
-    if (lhs.isMinus) {
-        if (lhs.length != rhs.length) {
-            return lhs.length > rhs.length;
+    size_t len = n + m - 1;
+    std::fill(r, r + len, 0);
+    for (size_t i = 0; i < z0.size(); ++i) {
+        r[i] += z0[i];
+    }
+    for (size_t i = 0; i < z1.size() && i + h < len; ++i) {
+        r[i + h] += z1[i];
+    }
+    for (size_t i = 0; i < z2.size(); ++i) {
+        r[i + 2 * h] += z2[i];
+    }
+}
+
+// 要求n >= m > 2 * ceil(n / 3).三段分别在0, 1, -1, -2, 无穷处求值,五次递归乘法后插值(Bodrato的顺序)
+void Bint::_ConvolveToom3(const coef_t *a, size_t n, const coef_t *b, size_t m, conv_t *r, coef_t limit)
+{
+    size_t k = (n + 2) / 3;
+    size_t len = 2 * k - 1;
+    // 求值:p(1), p(-1), p(-2);p(0)和p(无穷)就是最低段和最高段本身
+    auto evaluate = [k](const coef_t *x, size_t lx, _Scratch<coef_t> &p1, _Scratch<coef_t> &pm1,
+                        _Scratch<coef_t> &pm2) {
+        p1.assign(k, 0);
+        pm1.assign(k, 0);
+        pm2.assign(k, 0);
+        for (size_t i = 0; i < k; ++i) {
+            coef_t x0 = x[i];
+            coef_t x1 = k + i < lx ? x[k + i] : 0;
+            coef_t x2 = 2 * k + i < lx ? x[2 * k + i] : 0;
+            p1[i] = x0 + x1 + x2;
+            pm1[i] = x0 - x1 + x2;
+            pm2[i] = x0 - 2 * x1 + 4 * x2;
+        }
+    };
+    _Scratch<coef_t> a1, am1, am2, b1, bm1, bm2;
+    evaluate(a, n, a1, am1, am2);
+    evaluate(b, m, b1, bm1, bm2);
+    _Scratch<conv_t> r0(len), r1(len), rm1(len), rm2(len), rinf(len, 0);
+    _Convolve(a, k, b, k, r0.data(), limit);
+    _Convolve(a1.data(), k, b1.data(), k, r1.data(), 3 * limit);
+    _Convolve(am1.data(), k, bm1.data(), k, rm1.data(), 3 * limit);
+    _Convolve(am2.data(), k, bm2.data(), k, rm2.data(), 7 * limit);
+    _Convolve(a + 2 * k, n - 2 * k, b + 2 * k, m - 2 * k, rinf.data(), limit);
+
+    // 插值,除法都是整除
+    for (size_t i = 0; i < len; ++i) {
+        conv_t c3 = (rm2[i] - r1[i]) / 3;
+        conv_t c1 = (r1[i] - rm1[i]) / 2;
+        conv_t c2 = rm1[i] - r0[i];
+        c3 = (c2 - c3) / 2 + 2 * rinf[i];
+        c2 = c2 + c1 - rinf[i];
+        c1 = c1 - c3;
+        r1[i] = c1;
+        rm1[i] = c2;
+        rm2[i] = c3;
+    }
+    size_t total = n + m - 1;
+    std::fill(r, r + total, 0);
+    const _Scratch<conv_t> *parts[5] = {&r0, &r1, &rm1, &rm2, &rinf};
+    for (size_t p = 0; p < 5; ++p) {
+        for (size_t i = 0; i < len && p * k + i < total; ++i) {
+            r[p * k + i] += (*parts[p])[i];
         }
-        for (long long i = lhs.length - 1; i >= 0; --i) {
-            if (lhs.data[i] != rhs.data[i]) {
-                return lhs.data[i] > rhs.data[i];
+    }
+}
+
+// 系数上界放大growth倍之后,是否仍在coef_t范围内,且长度为m的两个多项式之积在插值过程中
+// 仍在conv_t范围内(留16倍余量)
+bool Bint::_ConvolveFits(size_t m, coef_t limit, int growth)
+{
+    double grown = static_cast<double>(limit) * growth;
+    return grown < 4e18 && static_cast<double>(m) * grown * grown * 16 < 8e37;
+}
+
+// 按较短者的长度选择算法;长短悬殊时把长的切成若干段.
+// 递归会放大系数,下一层可能溢出时退回竖式乘法(调用者保证竖式乘法不溢出)
+void Bint::_Convolve(const coef_t *a, size_t n, const coef_t *b, size_t m, conv_t *r, coef_t limit)
+{
+    if (n < m) {
+        std::swap(a, b);
+        std::swap(n, m);
+    }
+    if (m < 2 || (m < multiplyThresholds.karatsuba && m < multiplyThresholds.toom3)) {
+        _ConvolveSchool(a, n, b, m, r);
+    } else if (n >= 2 * m) {
+        std::fill(r, r + n + m - 1, 0);
+        _Scratch<conv_t> part(2 * m - 1);
+        for (size_t i = 0; i < n; i += m) {
+            size_t len = std::min(m, n - i);
+            _Convolve(a + i, len, b, m, part.data(), limit);
+            for (size_t j = 0; j < len + m - 1; ++j) {
+                r[i + j] += part[j];
             }
         }
-        return true;
+    } else if (m >= multiplyThresholds.toom3 && m > 2 * ((n + 2) / 3) && _ConvolveFits((n + 2) / 3, limit, 7)) {
+        _ConvolveToom3(a, n, b, m, r, limit);
+    } else if (m >= multiplyThresholds.karatsuba && _ConvolveFits(n - n / 2, limit, 2)) {
+        _ConvolveKaratsuba(a, n, b, m, r, limit);
     } else {
-        if (lhs.length != rhs.length) {
-            return lhs.length < rhs.length;
+        _ConvolveSchool(a, n, b, m, r);
+    }
+}
+
+// 一组线程的同步点:所有线程都调用wait()之后才一起继续
+class Bint::_Barrier
+{
+public:
+    explicit _Barrier(unsigned count) : count(count), waiting(0), generation(0) {}
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        unsigned current = generation;
+        if (++waiting == count) {
+            waiting = 0;
+            ++generation;
+            cond.notify_all();
+            return;
         }
-        for (long long i = lhs.length - 1; i >= 0; --i) {
-            if (lhs.data[i] != rhs.data[i]) {
-                return lhs.data[i] < rhs.data[i];
-            }
+        cond.wait(lock, [&] { return generation != current; });
+    }
+
+    // 只能在还没有人等待的那一轮里减少人数
+    void resize(unsigned n)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        count = n;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    unsigned count, waiting, generation;
+};
+
+// 用threads个线程(含调用者)执行work(id, team, barrier),id取[0, team).
+// 创建线程失败时由已经启动的线程组成人数较少的team,工作在第一次同步之后才按team划分
+template<class F>
+void Bint::_RunTeam(unsigned threads, F work)
+{
+    _Barrier barrier(threads);
+    unsigned team = threads;
+    auto run = [&](unsigned id) {
+        barrier.wait();
+        work(id, team, barrier);
+    };
+    std::vector<std::thread> helpers;
+    helpers.reserve(threads - 1);
+    try {
+        for (unsigned id = 1; id < threads; ++id) {
+            helpers.emplace_back(run, id);
         }
-        return true;
+    } catch (const std::system_error &) {
+        team = static_cast<unsigned>(helpers.size()) + 1;
+        barrier.resize(team);
+    }
+    run(0);
+    for (std::thread &helper : helpers) {
+        helper.join();
     }
 }
 
-bool operator>=(const Bint &lhs, const Bint &rhs)
+// 模MOD的数论变换,roots[h + j]为2h次单位根的j次幂.正变换按频率抽取,输入自然序、输出位逆序;
+// INVERSE时按时间抽取,输入位逆序、输出自然序,同样使用正向的单位根.
+// 数组分成blocks块,长度不超过一块的各层每个线程各做自己的块,更长的层按蝶形编号均分并逐层同步
+template<unsigned MOD, bool INVERSE>
+void Bint::_NTT(unsigned *a, const unsigned *roots, size_t size, size_t blocks,
+                unsigned id, unsigned team, _Barrier &barrier)
 {
-    if (lhs.isMinus != rhs.isMinus) {
-        return lhs.isMinus;
-    }
-    if (lhs.isMinus) {
-        if (lhs.length != rhs.length) {
-            return lhs.length < rhs.length;
+    auto butterfly = [a](size_t p, size_t half, unsigned long long w) {
+        unsigned u = a[p], v = a[p + half];
+        if (INVERSE) {
+            v = static_cast<unsigned>(v * w % MOD);
+            a[p] = u + v >= MOD ? u + v - MOD : u + v;
+            a[p + half] = u >= v ? u - v : u + MOD - v;
+        } else {
+            a[p] = u + v >= MOD ? u + v - MOD : u + v;
+            a[p + half] = static_cast<unsigned>((u + MOD - v) * w % MOD);
         }
-        for (long long i = lhs.length - 1; i >= 0; --i) {
-            if (lhs.data[i] != rhs.data[i]) {
-                return lhs.data[i] < rhs.data[i];
+    };
+    size_t block = size / blocks;
+    auto local = [&](size_t len) {
+        size_t half = len >> 1;
+        for (size_t start = id * block; start < size; start += team * block) {
+            for (size_t i = start; i < start + block; i += len) {
+                for (size_t j = 0; j < half; ++j) {
+                    butterfly(i + j, half, roots[half + j]);
+                }
             }
         }
-        return true;
+    };
+    auto global = [&](size_t len) {
+        size_t half = len >> 1, count = size >> 1;
+        size_t from = count * id / team, to = count * (id + 1) / team;
+        size_t i = from / half * len, j = from % half;
+        for (size_t k = from; k < to; ++k) {
+            butterfly(i + j, half, roots[half + j]);
+            if (++j == half) {
+                j = 0;
+                i += len;
+            }
+        }
+        barrier.wait();
+    };
+    if (INVERSE) {
+        for (size_t len = 2; len <= block; len <<= 1) {
+            local(len);
+        }
+        barrier.wait();
+        for (size_t len = block << 1; len <= size; len <<= 1) {
+            global(len);
+        }
     } else {
-        if (lhs.length != rhs.length) {
-            return lhs.length > rhs.length;
+        for (size_t len = size; len > block; len >>= 1) {
+            global(len);
         }
-        for (long long i = lhs.length - 1; i >= 0; --i) {
-            if (lhs.data[i] != rhs.data[i]) {
-                return lhs.data[i] > rhs.data[i];
-            }
+        for (size_t len = block; len >= 2; len >>= 1) {
+            local(len);
         }
-        return true;
+        barrier.wait();
     }
 }
 
-
-Bint operator+(const Bint &lhs, const Bint &rhs)
+// 线程id在模MOD下的那一份工作:fa = a, fb = b,两者变换后逐项相乘,再做一次变换.
+// 结果的第i项存放在fa[(size - i) % size]中,还差乘以size^-1
+template<unsigned MOD>
+void Bint::_ConvolveMod(const limb_t *a, size_t n, const limb_t *b, size_t m, unsigned *fa, unsigned *fb,
+                        unsigned *roots, size_t size, size_t blocks, unsigned id, unsigned team,
+                        _Barrier &barrier)
 {
-    if (lhs.isMinus == rhs.isMinus) {
-        size_t maxLen = std::max(lhs.length, rhs.length);
-        size_t expectLen = maxLen + 1;
-        Bint result(expectLen); // special constructor
-        for (size_t i = 0; i < maxLen; ++i) {
-            result.data[i] = lhs.data[i] + rhs.data[i];
-        }
-        for (size_t i = 0; i < maxLen; ++i) {
-            if (result.data[i] > 10000) {
-                result.data[i] -= 10000;
-                ++result.data[i + 1];
+    const unsigned long long g = 3; // 三个模数的原根都是3
+    auto power = [](unsigned long long base, unsigned long long e) {
+        unsigned long long result = 1;
+        for (base %= MOD; e; e >>= 1, base = base * base % MOD) {
+            if (e & 1) {
+                result = result * base % MOD;
             }
         }
-        result.length = result.data[maxLen] > 0 ? maxLen + 1 : maxLen;
-        result.isMinus = lhs.isMinus;
         return result;
-    } else {
-        if (lhs.isMinus) {
-            return rhs - abs(lhs);
-        } else {
-            return lhs - abs(rhs);
+    };
+    size_t half = size >> 1;
+    for (size_t i = size * id / team, end = size * (id + 1) / team; i < end; ++i) {
+        fa[i] = i < n ? a[i] % MOD : 0;
+        fb[i] = i < m ? b[i] % MOD : 0;
+    }
+    // 先算最长一层的单位根,较短的层是它的子序列
+    size_t from = half * id / team, to = half * (id + 1) / team;
+    unsigned long long w = power(g, (MOD - 1) / size), x = power(w, from);
+    for (size_t j = from; j < to; ++j, x = x * w % MOD) {
+        roots[half + j] = static_cast<unsigned>(x);
+    }
+    barrier.wait();
+    size_t h = 1;
+    for (size_t i = std::max<size_t>(from, 1); i < to; ++i) {
+        while (h << 1 <= i) {
+            h <<= 1;
         }
+        roots[i] = roots[half + (i - h) * (half / h)];
     }
+    barrier.wait();
+    _NTT<MOD, false>(fa, roots, size, blocks, id, team, barrier);
+    _NTT<MOD, false>(fb, roots, size, blocks, id, team, barrier);
+    for (size_t i = size * id / team, end = size * (id + 1) / team; i < end; ++i) {
+        fa[i] = static_cast<unsigned>(static_cast<unsigned long long>(fa[i]) * fb[i] % MOD);
+    }
+    barrier.wait();
+    _NTT<MOD, true>(fa, roots, size, blocks, id, team, barrier);
 }
 
-Bint operator-(const Bint &b)
+// r[0, n + m - 1) += a * b.三个NTT模数分别做循环卷积,再用中国剩余定理还原系数.
+// 要求n + m - 1 <= 2^23:此时系数小于2^22 * BASE^2,不超过三个模数之积
+void Bint::_ConvolveNTT(const limb_t *a, size_t n, const limb_t *b, size_t m, conv_t *r, unsigned threads)
 {
-    Bint result(b);
-    result.isMinus = !result.isMinus;
-    return result;
+    const unsigned P1 = 998244353, P2 = 167772161, P3 = 469762049;
+    size_t len = n + m - 1;
+    size_t size = 1;
+    while (size < len) {
+        size <<= 1;
+    }
+    _Scratch<unsigned> res[3], other(size), roots(size);
+    for (int k = 0; k < 3; ++k) {
+        res[k].resize(size);
+    }
+
+    auto power = [](unsigned long long base, unsigned long long e, unsigned long long mod) {
+        unsigned long long result = 1;
+        for (base %= mod; e; e >>= 1, base = base * base % mod) {
+            if (e & 1) {
+                result = result * base % mod;
+            }
+        }
+        return result;
+    };
+    const unsigned long long inv1 = power(P1, P2 - 2, P2); // P1^-1 mod P2
+    const unsigned long long inv12 = power(1ULL * P1 * P2 % P3, P3 - 2, P3); // (P1 P2)^-1 mod P3
+    const unsigned long long invSize[3] = {power(size, P1 - 2, P1), power(size, P2 - 2, P2),
+                                           power(size, P3 - 2, P3)};
+    _RunTeam(threads, [&](unsigned id, unsigned team, _Barrier &barrier) {
+        // 块数取不小于4 * team的2的幂,使各线程分到的块数相差不大
+        size_t blocks = 1;
+        while (team > 1 && blocks < 4 * team && blocks < size / 2) {
+            blocks <<= 1;
+        }
+        _ConvolveMod<P1>(a, n, b, m, res[0].data(), other.data(), roots.data(), size, blocks, id, team, barrier);
+        _ConvolveMod<P2>(a, n, b, m, res[1].data(), other.data(), roots.data(), size, blocks, id, team, barrier);
+        _ConvolveMod<P3>(a, n, b, m, res[2].data(), other.data(), roots.data(), size, blocks, id, team, barrier);
+        for (size_t i = len * id / team, end = len * (id + 1) / team; i < end; ++i) {
+            size_t at = (size - i) & (size - 1);
+            unsigned long long x1 = res[0][at] * invSize[0] % P1;
+            unsigned long long x2 = res[1][at] * invSize[1] % P2;
+            unsigned long long x3 = res[2][at] * invSize[2] % P3;
+            x2 = (x2 + P2 - x1 % P2) % P2 * inv1 % P2;
+            x3 = (x3 + P3 - (x1 + x2 * P1) % P3) % P3 * inv12 % P3;
+            r[i] += x1 + static_cast<conv_t>(x2) * P1 + static_cast<conv_t>(x3) * (1ULL * P1 * P2);
+        }
+    });
 }
 
-Bint operator-(Bint &&b)
+// 超出单次NTT长度的乘数按2^21位分段,逐对相乘后累加
+void Bint::_MulNTT(const Bint &lhs, const Bint &rhs, Bint &result)
 {
-    b.isMinus = !b.isMinus;
-    return b;
+    const size_t PIECE = static_cast<size_t>(1) << 21;
+    size_t len = lhs.length + rhs.length - 1;
+    unsigned threads = 1;
+    if (std::min(lhs.length, rhs.length) >= multiplyThresholds.parallel && multiplyThreads > 1) {
+        threads = multiplyThreads;
+    }
+    _Scratch<conv_t> c(len, 0);
+    for (size_t i = 0; i < lhs.length; i += PIECE) {
+        for (size_t j = 0; j < rhs.length; j += PIECE) {
+            _ConvolveNTT(lhs.data + i, std::min(PIECE, lhs.length - i), rhs.data + j,
+                         std::min(PIECE, rhs.length - j), c.data() + i + j, threads);
+        }
+    }
+    _CarryOut(c.data(), len, result);
 }
 
-Bint operator-(const Bint &lhs, const Bint &rhs)
+// 把非负的卷积结果c[0, len)逐项进位写入result,共len + 1位;进位在64位以内时避免128位除法
+void Bint::_CarryOut(const conv_t *c, size_t len, Bint &result)
 {
-    if (lhs.isMinus == rhs.isMinus) {
-        if (lhs.isMinus) {
-            return -(abs(lhs) - abs(rhs));
+    typedef unsigned __int128 wide_t;
+    wide_t carry = 0;
+    for (size_t i = 0; i < len; ++i) {
+        carry += static_cast<wide_t>(c[i]);
+        unsigned long long low = static_cast<unsigned long long>(carry);
+        if (carry == low) {
+            result.data[i] = static_cast<limb_t>(low % BASE);
+            carry = low / BASE;
         } else {
-            if (lhs < rhs) {
-                return -(rhs - lhs);
-            }
-            Bint result(std::max(lhs.length, rhs.length));
-            for (size_t i = 0; i < lhs.length; ++i) {
-                result.data[i] = lhs.data[i] - rhs.data[i];
-            }
-            for (size_t i = 0; i < lhs.length; ++i) {
-                if (result.data[i] < 0) {
-                    result.data[i] += 10000;
-                    ++result.data[i + 1];
-                }
-            }
-            while (result.length > 1 && result.data[result.length - 1] == 0) {
-                --result.length;
+            result.data[i] = static_cast<limb_t>(carry % BASE);
+            carry /= BASE;
+        }
+    }
+    result.data[len] = static_cast<limb_t>(carry);
+    result.length = len + 1;
+}
+
+// |result| = |lhs| * |rhs|,result的容量至少为两者位数之和,不能与lhs或rhs是同一个对象
+void Bint::_MulAbs(const Bint &lhs, const Bint &rhs, Bint &result)
+{
+    size_t n = lhs.length, m = rhs.length;
+    size_t shorter = std::min(n, m);
+    if (shorter >= multiplyThresholds.ntt) {
+        _MulNTT(lhs, rhs, result);
+        return;
+    }
+    size_t len = n + m - 1;
+    conv_t stackBuffer[32];
+    _Scratch<conv_t> heapBuffer;
+    conv_t *c = stackBuffer;
+    if (len > 32) {
+        heapBuffer.resize(len);
+        c = heapBuffer.data();
+    }
+    if (shorter < multiplyThresholds.karatsuba && shorter < multiplyThresholds.toom3) {
+        // 直接在位上做竖式乘法,不做中间进位;两位之积用64位乘法,累加到128位
+        std::fill(c, c + len, 0);
+        for (size_t i = 0; i < n; ++i) {
+            unsigned long long x = lhs.data[i];
+            for (size_t j = 0; j < m; ++j) {
+                c[i + j] += x * rhs.data[j];
             }
-            return result;
         }
     } else {
-        return lhs + (-rhs);
+        _Scratch<coef_t> a(lhs.data, lhs.data + n), b(rhs.data, rhs.data + m);
+        _Convolve(a.data(), n, b.data(), m, c, BASE - 1);
     }
+    _CarryOut(c, len, result);
 }
 
 Bint operator*(const Bint &lhs, const Bint &rhs)
 {
-    size_t expectLen = lhs.length + rhs.length + 2;
-    Bint result(expectLen);
-    for (size_t i = 0; i < lhs.length; ++i) {
-        for (size_t j = 0; j < rhs.length; ++j) {
-            long long tmp = result.data[i + j] + static_cast<long long>(lhs.data[i]) * rhs.data[j];
-            if (tmp >= 10000) {
-                result.data[i + j] = tmp % 10000;
-                result.data[i + j + 1] += static_cast<int>(tmp / 10000);
-            } else {
-                result.data[i + j] = tmp;
+    Bint result(lhs.length + rhs.length);
+    Bint::_MulAbs(lhs, rhs, result);
+    result.isMinus = lhs.isMinus != rhs.isMinus;
+    result._Trim();
+    return result;
+}
+
+// 乘积不能原地写入乘数,算好之后换进来
+Bint &Bint::operator*=(const Bint &rhs)
+{
+    return *this = *this * rhs;
+}
+
+// 乘数小于BASE时逐位乘,进位在64位以内;更大的乘数转成Bint
+Bint &Bint::operator*=(long long rhs)
+{
+    unsigned long long magnitude = static_cast<unsigned long long>(rhs);
+    if (rhs < 0) {
+        magnitude = 0 - magnitude;
+    }
+    if (magnitude >= BASE) {
+        return *this *= Bint(rhs);
+    }
+    unsigned long long carry = 0;
+    for (size_t i = 0; i < length; ++i) {
+        carry += data[i] * magnitude;
+        data[i] = static_cast<limb_t>(carry % BASE);
+        carry /= BASE;
+    }
+    if (carry) {
+        _Reserve(length + 1);
+        data[length++] = static_cast<limb_t>(carry);
+    }
+    isMinus = isMinus != (rhs < 0);
+    _Trim();
+    return *this;
+}
+
+// quotient = |lhs| / divisor,返回余数;quotient可以就是lhs,容量至少为lhs的位数
+Bint::limb_t Bint::_DivSmall(const Bint &lhs, limb_t divisor, Bint &quotient)
+{
+    unsigned long long rem = 0;
+    size_t len = lhs.length;
+    for (size_t i = len; i-- > 0; ) {
+        unsigned long long cur = rem * BASE + lhs.data[i];
+        quotient.data[i] = static_cast<limb_t>(cur / divisor);
+        rem = cur % divisor;
+    }
+    quotient.length = len;
+    quotient._Trim();
+    return static_cast<limb_t>(rem);
+}
+
+// Knuth算法D.先把两数同乘d使除数最高位不小于BASE / 2,这样每一位商的估计值至多大2;
+// 用除数的次高位修正后至多大1,相减为负时加回一次.不能与quotient、remainder是同一个对象
+void Bint::_DivModAbs(const Bint &lhs, const Bint &rhs, Bint &quotient, Bint &remainder)
+{
+    quotient.isMinus = remainder.isMinus = false;
+    if (_CompareAbs(lhs, rhs) < 0) {
+        quotient = 0;
+        remainder = lhs;
+        remainder.isMinus = false;
+        return;
+    }
+    if (rhs.length == 1) {
+        quotient._Reserve(lhs.length);
+        remainder = static_cast<long long>(_DivSmall(lhs, rhs.data[0], quotient));
+        return;
+    }
+
+    size_t n = rhs.length, m = lhs.length - rhs.length;
+    limb_t d = static_cast<limb_t>(BASE / (static_cast<unsigned long long>(rhs.data[n - 1]) + 1));
+    _Scratch<limb_t> u(lhs.length + 1), v(n);
+    // 乘以d,进位在64位以内
+    auto scale = [d](const limb_t *from, size_t len, limb_t *to) {
+        unsigned long long carry = 0;
+        for (size_t i = 0; i < len; ++i) {
+            carry += static_cast<unsigned long long>(from[i]) * d;
+            to[i] = static_cast<limb_t>(carry % BASE);
+            carry /= BASE;
+        }
+        return static_cast<limb_t>(carry);
+    };
+    u[lhs.length] = scale(lhs.data, lhs.length, u.data());
+    scale(rhs.data, n, v.data());
+
+    quotient._Reserve(m + 1);
+    unsigned long long top = v[n - 1], second = v[n - 2];
+    for (size_t j = m + 1; j-- > 0; ) {
+        unsigned long long num = u[j + n] * static_cast<unsigned long long>(BASE) + u[j + n - 1];
+        unsigned long long qhat = num / top, rhat = num % top;
+        while (qhat >= BASE || qhat * second > rhat * BASE + u[j + n - 2]) {
+            --qhat;
+            rhat += top;
+            if (rhat >= BASE) {
+                break;
             }
         }
+        // u[j, j + n] -= qhat * v
+        unsigned long long carry = 0;
+        long long borrow = 0;
+        for (size_t i = 0; i < n; ++i) {
+            carry += qhat * v[i];
+            long long t = static_cast<long long>(u[i + j]) - static_cast<long long>(carry % BASE) - borrow;
+            carry /= BASE;
+            borrow = t < 0;
+            u[i + j] = static_cast<limb_t>(t < 0 ? t + BASE : t);
+        }
+        long long t = static_cast<long long>(u[j + n]) - static_cast<long long>(carry) - borrow;
+        if (t < 0) {
+            --qhat;
+            limb_t c = 0;
+            for (size_t i = 0; i < n; ++i) {
+                limb_t sum = u[i + j] + v[i] + c;
+                c = sum >= BASE;
+                u[i + j] = c ? sum - BASE : sum;
+            }
+            t += c;
+        }
+        u[j + n] = static_cast<limb_t>(t);
+        quotient.data[j] = static_cast<limb_t>(qhat);
     }
-    result.length = lhs.length + rhs.length -1;
-    while (result.data[result.length] > 0) {
-        ++result.length;
+    quotient.length = m + 1;
+    quotient._Trim();
+
+    // 余数是u的低n位除以d
+    remainder.length = 0;
+    remainder._Reserve(n);
+    memcpy(remainder.data, u.data(), sizeof(limb_t) * n);
+    remainder.length = n;
+    _DivSmall(remainder, d, remainder);
+}
+
+// 从第from位起的高位部分,即|*this| / BASE^from
+Bint Bint::_Limbs(size_t from) const
+{
+    if (from >= length) {
+        return Bint();
     }
-    while (result.length > 1 && result.data[result.length - 1] == 0) {
-        --result.length;
+    Bint result(length - from);
+    memcpy(result.data, data + from, sizeof(limb_t) * (length - from));
+    result.length = length - from;
+    return result;
+}
+
+void divmod(const Bint &lhs, const Bint &rhs, Bint &quotient, Bint &remainder)
+{
+    if (rhs.length == 1 && rhs.data[0] == 0) {
+        throw Bint::DivideByZero();
+    }
+    Bint q, r;
+    Bint::_DivModAbs(lhs, rhs, q, r);
+    q.isMinus = lhs.isMinus != rhs.isMinus;
+    r.isMinus = lhs.isMinus;
+    q._Trim();
+    r._Trim();
+    quotient = std::move(q);
+    remainder = std::move(r);
+}
+
+Bint operator/(const Bint &lhs, const Bint &rhs)
+{
+    Bint quotient, remainder;
+    divmod(lhs, rhs, quotient, remainder);
+    return quotient;
+}
+
+Bint operator%(const Bint &lhs, const Bint &rhs)
+{
+    Bint quotient, remainder;
+    divmod(lhs, rhs, quotient, remainder);
+    return remainder;
+}
+
+Bint &Bint::operator/=(const Bint &rhs)
+{
+    Bint remainder;
+    divmod(*this, rhs, *this, remainder);
+    return *this;
+}
+
+Bint &Bint::operator%=(const Bint &rhs)
+{
+    Bint quotient;
+    divmod(*this, rhs, quotient, *this);
+    return *this;
+}
+
+// 从高位到低位的二进制快速幂
+Bint pow(const Bint &base, unsigned long long exponent)
+{
+    if (exponent == 0) {
+        return Bint(1);
+    }
+    int bit = 63;
+    while (!(exponent >> bit & 1)) {
+        --bit;
+    }
+    Bint result(base);
+    while (bit-- > 0) {
+        result *= result;
+        if (exponent >> bit & 1) {
+            result *= base;
+        }
     }
     return result;
 }
 
-Bint::~Bint()
+// 模m的Barrett约减:预先算出mu = BASE^(2k) / m(k为m的位数),
+// 对x < m^2,q = (x / BASE^(k-1) * mu) / BASE^(k+1)比x / m至多小2,
+// 于是每次约减只需两次乘法和至多两次减法,不再做长除法.
+// 指数按4位一组从高到低处理,预先算好base的0到15次方
+Bint powmod(const Bint &base, const Bint &exponent, const Bint &modulus)
 {
-    if (data != nullptr) {
-        delete[] data;
-        data = nullptr;
+    if (modulus.length == 1 && modulus.data[0] == 0) {
+        throw Bint::DivideByZero();
+    }
+    if (exponent.isMinus) {
+        throw Bint::NegativeExponent();
+    }
+    Bint m = abs(modulus);
+    if (m == 1) {
+        return Bint();
+    }
+    size_t k = m.length;
+    Bint power(2 * k + 1), mu, unused;
+    std::fill(power.data, power.data + 2 * k, 0);
+    power.data[2 * k] = 1;
+    power.length = 2 * k + 1;
+    Bint::_DivModAbs(power, m, mu, unused);
+    auto reduce = [&](Bint &x) {
+        Bint q = x._Limbs(k - 1) * mu;
+        x -= q._Limbs(k + 1) * m;
+        while (x >= m) {
+            x -= m;
+        }
+    };
+
+    // 指数的二进制位,每次除以2^29取出29位
+    const Bint::limb_t CHUNK = static_cast<Bint::limb_t>(1) << 29;
+    Bint::_Scratch<unsigned char> bits;
+    Bint e = exponent;
+    while (!(e.length == 1 && e.data[0] == 0)) {
+        Bint::limb_t chunk = Bint::_DivSmall(e, CHUNK, e);
+        for (int i = 0; i < 29; ++i) {
+            bits.push_back(chunk >> i & 1);
+        }
+    }
+    while (!bits.empty() && bits.back() == 0) {
+        bits.pop_back();
+    }
+
+    Bint table[16];
+    table[0] = 1;
+    table[1] = base % m;
+    if (table[1].isMinus) {
+        table[1] += m;
+    }
+    for (int i = 2; i < 16; ++i) {
+        table[i] = table[i - 1] * table[1];
+        reduce(table[i]);
+    }
+    auto window = [&bits](size_t g) {
+        int w = 0;
+        for (int i = 3; i >= 0; --i) {
+            size_t pos = 4 * g + i;
+            w = w << 1 | (pos < bits.size() ? bits[pos] : 0);
+        }
+        return w;
+    };
+    size_t groups = (bits.size() + 3) / 4;
+    if (groups == 0) {
+        return Bint(1);
     }
+    Bint result = table[window(groups - 1)];
+    for (size_t g = groups - 1; g-- > 0; ) {
+        for (int i = 0; i < 4; ++i) {
+            result *= result;
+            reduce(result);
+        }
+        int w = window(g);
+        if (w) {
+            result *= table[w];
+            reduce(result);
+        }
+    }
+    return result;
 }
-}
\ No newline at end of file
+
+void Bint::tuneMultiply()
+{
+    typedef std::chrono::steady_clock clock;
+    const size_t never = static_cast<size_t>(-1);
+    // 随机的size位操作数
+    auto operand = [](size_t size, unsigned long long seed) {
+        Bint x(size);
+        for (size_t i = 0; i < size; ++i) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            x.data[i] = static_cast<limb_t>((seed >> 32) % BASE);
+        }
+        x.data[size - 1] |= 1;
+        x.length = size;
+        return x;
+    };
+    // 在给定阈值下做一次size位乘法的耗时,取三轮(每轮至少1毫秒)中最快的一轮以压低噪声
+    auto measure = [&](size_t size, MultiplyThresholds thresholds) {
+        Bint a = operand(size, 1), b = operand(size, 2), r(2 * size);
+        MultiplyThresholds saved = multiplyThresholds;
+        multiplyThresholds = thresholds;
+        double best = 0;
+        for (int round = 0; round < 3; ++round) {
+            size_t count = 0;
+            clock::time_point start = clock::now();
+            double elapsed = 0;
+            do {
+                _MulAbs(a, b, r);
+                ++count;
+                elapsed = std::chrono::duration<double>(clock::now() - start).count();
+            } while (elapsed < 1e-3);
+            if (round == 0 || elapsed / count < best) {
+                best = elapsed / count;
+            }
+        }
+        multiplyThresholds = saved;
+        return best;
+    };
+    // 从lower开始倍增,找到只在最顶层换用下一级算法时连续两个位数都更快的位置
+    auto crossover = [&](size_t lower, size_t upper, MultiplyThresholds base, size_t MultiplyThresholds::*field) {
+        bool won = false;
+        for (size_t size = lower; size <= upper; size <<= 1) {
+            MultiplyThresholds next = base;
+            next.*field = size;
+            if (measure(size, next) < measure(size, base)) {
+                if (won) {
+                    return size >> 1;
+                }
+                won = true;
+            } else {
+                won = false;
+            }
+        }
+        return never;
+    };
+    // 只调单线程的交叉点,parallel保持原值
+    MultiplyThresholds tuned = {never, never, never, never};
+    tuned.karatsuba = crossover(16, 2048, tuned, &MultiplyThresholds::karatsuba);
+    tuned.toom3 = crossover(tuned.karatsuba == never ? 16 : tuned.karatsuba, 16384, tuned,
+                            &MultiplyThresholds::toom3);
+    tuned.ntt = crossover(256, 1 << 17, tuned, &MultiplyThresholds::ntt);
+    tuned.parallel = multiplyThresholds.parallel;
+    multiplyThresholds = tuned;
+}
+
+Bint::~Bint()
+{
+    _Release();
+}
+}
+
+#endif
@@ -0,0 +1,582 @@
+#ifndef UTIL_FIXED_BINT_HPP
+#define UTIL_FIXED_BINT_HPP
+
+#include "class-bint.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace Util {
+
+    // 位宽固定的大整数类
+/**
+ * Bits位的有符号整数,以二进制补码存放在对象内(低位在前的64位字),
+ * 溢出时和内置整数一样按2^Bits回绕.运算符与Bint相同;
+ * 各循环的次数都是编译期常量,由编译器展开,字之间的进位经unsigned __int128传递.
+ * 平凡可复制,可以直接放进deque的块和矩阵里.与Bint之间显式转换,转成FixedBint时按2^Bits取模.
+ */
+template<size_t Bits>
+class FixedBint {
+    static_assert(Bits >= 64 && Bits % 64 == 0, "FixedBint needs a positive multiple of 64 bits");
+    template<size_t> friend class FixedBint;
+
+    typedef uint64_t word_t;
+    typedef unsigned __int128 wide_t;
+    static const size_t WORDS = Bits / 64;
+    static const word_t CHUNK = 10000000000000000000ULL; // 十进制转换时每次处理19位
+    static const int CHUNK_DIGITS = 19;
+    static const size_t MAX_CHARS = Bits * 30103 / 100000 + 2; // 十进制位数的上界,加上负号
+
+    word_t words[WORDS]; // 低位在前
+
+    constexpr bool _Negative() const
+    {
+        return words[WORDS - 1] >> 63;
+    }
+
+    constexpr bool _IsZero() const
+    {
+        #pragma GCC unroll 16
+        for (size_t i = 0; i < WORDS; ++i) {
+            if (words[i] != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 取反加一;最小的负数不变
+    constexpr void _Negate()
+    {
+        word_t carry = 1;
+        #pragma GCC unroll 16
+        for (size_t i = 0; i < WORDS; ++i) {
+            wide_t sum = static_cast<wide_t>(~words[i]) + carry;
+            words[i] = static_cast<word_t>(sum);
+            carry = static_cast<word_t>(sum >> 64);
+        }
+    }
+
+    // *this = *this * mul + add,按无符号数计算并回绕
+    constexpr void _MulAdd(word_t mul, word_t add)
+    {
+        word_t carry = add;
+        #pragma GCC unroll 16
+        for (size_t i = 0; i < WORDS; ++i) {
+            wide_t cur = static_cast<wide_t>(words[i]) * mul + carry;
+            words[i] = static_cast<word_t>(cur);
+            carry = static_cast<word_t>(cur >> 64);
+        }
+    }
+
+    // 按无符号数除以一个字,返回余数
+    constexpr word_t _DivSmall(word_t divisor)
+    {
+        word_t rem = 0;
+        for (size_t i = WORDS; i-- > 0;) {
+            wide_t cur = static_cast<wide_t>(rem) << 64 | words[i];
+            words[i] = static_cast<word_t>(cur / divisor);
+            rem = static_cast<word_t>(cur % divisor);
+        }
+        return rem;
+    }
+
+    // 按另一位宽的值赋值,多出的高位截断,不足的高位按sign扩展
+    template<size_t Other>
+    constexpr void _Assign(const FixedBint<Other> &x, bool sign)
+    {
+        #pragma GCC unroll 16
+        for (size_t i = 0; i < WORDS; ++i) {
+            words[i] = i < FixedBint<Other>::WORDS ? x.words[i] : sign ? ~static_cast<word_t>(0) : 0;
+        }
+    }
+
+    // 按无符号数,u = quotient * v + remainder,v不为0.用Knuth算法D,每一位是一个64位字
+    static constexpr void _DivModUnsigned(const FixedBint &u, const FixedBint &v, FixedBint &quotient,
+                                          FixedBint &remainder)
+    {
+        size_t n = WORDS, m = WORDS;
+        while (v.words[n - 1] == 0) {
+            --n;
+        }
+        while (m > 0 && u.words[m - 1] == 0) {
+            --m;
+        }
+        FixedBint q;
+        if (WORDS == 1 || n == 1) {
+            q = u;
+            word_t rem = q._DivSmall(v.words[0]);
+            quotient = q;
+            remainder = FixedBint();
+            remainder.words[0] = rem;
+            return;
+        }
+        if (m < n) {
+            remainder = u;
+            quotient = q;
+            return;
+        }
+        // 规格化:除数的最高位移到字的最高位,试商最多大2
+        int shift = __builtin_clzll(v.words[n - 1]);
+        word_t vn[WORDS] = {}, un[WORDS + 1] = {};
+        for (size_t i = n; i-- > 0;) {
+            vn[i] = v.words[i] << shift | (shift && i > 0 ? v.words[i - 1] >> (64 - shift) : 0);
+        }
+        un[m] = shift ? u.words[m - 1] >> (64 - shift) : 0;
+        for (size_t i = m; i-- > 0;) {
+            un[i] = u.words[i] << shift | (shift && i > 0 ? u.words[i - 1] >> (64 - shift) : 0);
+        }
+        for (size_t j = m - n + 1; j-- > 0;) {
+            wide_t num = static_cast<wide_t>(un[j + n]) << 64 | un[j + n - 1];
+            wide_t qhat = num / vn[n - 1], rhat = num % vn[n - 1];
+            while (qhat >> 64 || qhat * vn[n - 2] > (rhat << 64 | un[j + n - 2])) {
+                --qhat;
+                rhat += vn[n - 1];
+                if (rhat >> 64) {
+                    break;
+                }
+            }
+            word_t carry = 0, borrow = 0;
+            for (size_t i = 0; i < n; ++i) {
+                wide_t product = qhat * vn[i] + carry;
+                carry = static_cast<word_t>(product >> 64);
+                word_t low = static_cast<word_t>(product), x = un[i + j];
+                un[i + j] = x - low - borrow;
+                borrow = x < low || x - low < borrow;
+            }
+            word_t top = un[j + n];
+            un[j + n] = top - carry - borrow;
+            if (top < carry || top - carry < borrow) {
+                // 试商大了1,加回一个除数
+                --qhat;
+                word_t c = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    wide_t sum = static_cast<wide_t>(un[i + j]) + vn[i] + c;
+                    un[i + j] = static_cast<word_t>(sum);
+                    c = static_cast<word_t>(sum >> 64);
+                }
+                un[j + n] += c;
+            }
+            q.words[j] = static_cast<word_t>(qhat);
+        }
+        quotient = q;
+        remainder = FixedBint();
+        for (size_t i = 0; i < n; ++i) {
+            remainder.words[i] = un[i] >> shift | (shift ? un[i + 1] << (64 - shift) : 0);
+        }
+    }
+
+    // 有符号的除法,quotient和remainder可以与lhs、rhs是同一个对象
+    static constexpr void _DivMod(const FixedBint &lhs, const FixedBint &rhs, FixedBint &quotient,
+                                  FixedBint &remainder)
+    {
+        if (rhs._IsZero()) {
+            throw Bint::DivideByZero();
+        }
+        bool lhsMinus = lhs._Negative(), rhsMinus = rhs._Negative();
+        FixedBint u = lhs, v = rhs;
+        if (lhsMinus) {
+            u._Negate();
+        }
+        if (rhsMinus) {
+            v._Negate();
+        }
+        _DivModUnsigned(u, v, quotient, remainder);
+        if (lhsMinus != rhsMinus) {
+            quotient._Negate();
+        }
+        if (lhsMinus) {
+            remainder._Negate();
+        }
+    }
+
+    // 乘积在两倍位宽中计算,不会回绕
+    static FixedBint _PowMod(const FixedBint &base, const FixedBint &exponent, const FixedBint &modulus)
+    {
+        typedef FixedBint<2 * Bits> Wide;
+        if (modulus._IsZero()) {
+            throw Bint::DivideByZero();
+        }
+        if (exponent._Negative()) {
+            throw Bint::NegativeExponent();
+        }
+        // |modulus| <= 2^(Bits - 1),按无符号数扩展
+        FixedBint magnitude = modulus;
+        if (magnitude._Negative()) {
+            magnitude._Negate();
+        }
+        Wide m, b;
+        m._Assign(magnitude, false);
+        b._Assign(base, base._Negative());
+        b %= m;
+        if (b._Negative()) {
+            b += m;
+        }
+        Wide result = Wide(1) % m;
+        for (size_t i = Bits; i-- > 0;) {
+            result = result * result % m;
+            if (exponent.words[i / 64] >> (i % 64) & 1) {
+                result = result * b % m;
+            }
+        }
+        FixedBint out;
+        out._Assign(result, false);
+        return out;
+    }
+
+public:
+    constexpr FixedBint() : words{} {}
+
+    constexpr FixedBint(int x) : FixedBint(static_cast<long long>(x)) {}
+
+    constexpr FixedBint(long long x) : words{}
+    {
+        #pragma GCC unroll 16
+        for (size_t i = 0; i < WORDS; ++i) {
+            words[i] = i == 0 ? static_cast<word_t>(x) : x < 0 ? ~static_cast<word_t>(0) : 0;
+        }
+    }
+
+    // 与Bint相同:可以有若干个负号,之后必须全是数字且非空,否则抛出std::invalid_argument
+    FixedBint(const std::string &x) : words{}
+    {
+        size_t begin = 0;
+        bool minus = false;
+        while (begin < x.length() && x[begin] == '-') {
+            minus = !minus;
+            ++begin;
+        }
+        if (begin == x.length()) {
+            throw Bint::BadCast();
+        }
+        for (size_t i = begin; i < x.length(); ++i) {
+            if (x[i] > '9' || x[i] < '0') {
+                throw Bint::BadCast();
+            }
+            _MulAdd(10, x[i] - '0');
+        }
+        if (minus) {
+            _Negate();
+        }
+    }
+
+    // 位宽不同的FixedBint之间按符号扩展或截断
+    template<size_t Other>
+    constexpr explicit FixedBint(const FixedBint<Other> &x) : words{}
+    {
+        _Assign(x, x._Negative());
+    }
+
+    // 按2^Bits取模
+    explicit FixedBint(const Bint &b) : words{}
+    {
+        for (size_t i = b.length; i-- > 0;) {
+            _MulAdd(Bint::BASE, b.data[i]);
+        }
+        if (b.isMinus) {
+            _Negate();
+        }
+    }
+
+    explicit operator Bint() const
+    {
+        FixedBint magnitude = *this;
+        bool minus = _Negative();
+        if (minus) {
+            magnitude._Negate();
+        }
+        // 10^9 > 2^29,每29位至多对应一位
+        Bint result(static_cast<size_t>(Bits / 29 + 1));
+        size_t count = 0;
+        do {
+            result.data[count++] = static_cast<Bint::limb_t>(magnitude._DivSmall(Bint::BASE));
+        } while (!magnitude._IsZero());
+        result.length = count;
+        result.isMinus = minus;
+        result._Trim();
+        return result;
+    }
+
+    constexpr FixedBint &operator+=(const FixedBint &rhs)
+    {
+        word_t carry = 0;
+        #pragma GCC unroll 16
+        for (size_t i = 0; i < WORDS; ++i) {
+            wide_t sum = static_cast<wide_t>(words[i]) + rhs.words[i] + carry;
+            words[i] = static_cast<word_t>(sum);
+            carry = static_cast<word_t>(sum >> 64);
+        }
+        return *this;
+    }
+
+    constexpr FixedBint &operator-=(const FixedBint &rhs)
+    {
+        word_t borrow = 0;
+        #pragma GCC unroll 16
+        for (size_t i = 0; i < WORDS; ++i) {
+            wide_t diff = static_cast<wide_t>(words[i]) - rhs.words[i] - borrow;
+            words[i] = static_cast<word_t>(diff);
+            borrow = static_cast<word_t>(diff >> 64) & 1;
+        }
+        return *this;
+    }
+
+    // 补码的乘积与符号无关,只保留低WORDS个字
+    constexpr FixedBint &operator*=(const FixedBint &rhs)
+    {
+        word_t r[WORDS] = {};
+        #pragma GCC unroll 16
+        for (size_t i = 0; i < WORDS; ++i) {
+            word_t carry = 0;
+            #pragma GCC unroll 16
+            for (size_t j = 0; i + j < WORDS; ++j) {
+                wide_t cur = static_cast<wide_t>(words[i]) * rhs.words[j] + r[i + j] + carry;
+                r[i + j] = static_cast<word_t>(cur);
+                carry = static_cast<word_t>(cur >> 64);
+            }
+        }
+        #pragma GCC unroll 16
+        for (size_t i = 0; i < WORDS; ++i) {
+            words[i] = r[i];
+        }
+        return *this;
+    }
+
+    constexpr FixedBint &operator/=(const FixedBint &rhs)
+    {
+        FixedBint remainder;
+        divmod(*this, rhs, *this, remainder);
+        return *this;
+    }
+
+    constexpr FixedBint &operator%=(const FixedBint &rhs)
+    {
+        FixedBint quotient;
+        divmod(*this, rhs, quotient, *this);
+        return *this;
+    }
+
+    friend constexpr FixedBint abs(const FixedBint &x)
+    {
+        return x._Negative() ? -x : x;
+    }
+
+    friend constexpr bool operator==(const FixedBint &lhs, const FixedBint &rhs)
+    {
+        #pragma GCC unroll 16
+        for (size_t i = 0; i < WORDS; ++i) {
+            if (lhs.words[i] != rhs.words[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    friend constexpr bool operator!=(const FixedBint &lhs, const FixedBint &rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    // 符号相同时补码按无符号比较的结果就是大小关系
+    friend constexpr bool operator<(const FixedBint &lhs, const FixedBint &rhs)
+    {
+        if (lhs._Negative() != rhs._Negative()) {
+            return lhs._Negative();
+        }
+        for (size_t i = WORDS; i-- > 0;) {
+            if (lhs.words[i] != rhs.words[i]) {
+                return lhs.words[i] < rhs.words[i];
+            }
+        }
+        return false;
+    }
+
+    friend constexpr bool operator>(const FixedBint &lhs, const FixedBint &rhs)
+    {
+        return rhs < lhs;
+    }
+
+    friend constexpr bool operator<=(const FixedBint &lhs, const FixedBint &rhs)
+    {
+        return !(rhs < lhs);
+    }
+
+    friend constexpr bool operator>=(const FixedBint &lhs, const FixedBint &rhs)
+    {
+        return !(lhs < rhs);
+    }
+
+    friend constexpr FixedBint operator+(FixedBint lhs, const FixedBint &rhs)
+    {
+        return lhs += rhs;
+    }
+
+    friend constexpr FixedBint operator-(const FixedBint &b)
+    {
+        FixedBint result = b;
+        result._Negate();
+        return result;
+    }
+
+    friend constexpr FixedBint operator-(FixedBint lhs, const FixedBint &rhs)
+    {
+        return lhs -= rhs;
+    }
+
+    friend constexpr FixedBint operator*(FixedBint lhs, const FixedBint &rhs)
+    {
+        return lhs *= rhs;
+    }
+
+    // 与Bint一致:向零取整,余数与被除数同号;除数为0时抛出std::domain_error.最小的负数除以-1回绕为自身
+    friend constexpr void divmod(const FixedBint &lhs, const FixedBint &rhs, FixedBint &quotient,
+                                 FixedBint &remainder)
+    {
+        _DivMod(lhs, rhs, quotient, remainder);
+    }
+
+    friend constexpr FixedBint operator/(const FixedBint &lhs, const FixedBint &rhs)
+    {
+        FixedBint quotient, remainder;
+        divmod(lhs, rhs, quotient, remainder);
+        return quotient;
+    }
+
+    friend constexpr FixedBint operator%(const FixedBint &lhs, const FixedBint &rhs)
+    {
+        FixedBint quotient, remainder;
+        divmod(lhs, rhs, quotient, remainder);
+        return remainder;
+    }
+
+    friend constexpr FixedBint pow(FixedBint base, unsigned long long exponent)
+    {
+        FixedBint result = 1;
+        for (; exponent; exponent >>= 1, base *= base) {
+            if (exponent & 1) {
+                result *= base;
+            }
+        }
+        return result;
+    }
+
+    // base^exponent mod |modulus|,结果在[0, |modulus|)内;模数为0或指数为负时抛出std::domain_error
+    friend FixedBint powmod(const FixedBint &base, const FixedBint &exponent, const FixedBint &modulus)
+    {
+        return _PowMod(base, exponent, modulus);
+    }
+
+    // 十进制文本的长度,包括负号
+    size_t chars_size() const
+    {
+        char buffer[MAX_CHARS];
+        return static_cast<size_t>(to_chars(buffer, buffer + MAX_CHARS) - buffer);
+    }
+
+    // 把十进制文本写入[first, last),返回写完之后的位置;放不下时返回nullptr
+    char *to_chars(char *first, char *last) const
+    {
+        char buffer[MAX_CHARS];
+        char *end = buffer + MAX_CHARS, *p = end;
+        FixedBint magnitude = *this;
+        if (_Negative()) {
+            magnitude._Negate();
+        }
+        // 每次取出低19位,最高的一段不补前导0
+        do {
+            word_t chunk = magnitude._DivSmall(CHUNK);
+            bool top = magnitude._IsZero();
+            for (int i = 0; i < CHUNK_DIGITS && (!top || chunk != 0 || i == 0); ++i) {
+                *--p = static_cast<char>('0' + chunk % 10);
+                chunk /= 10;
+            }
+        } while (!magnitude._IsZero());
+        if (_Negative()) {
+            *--p = '-';
+        }
+        if (last - first < end - p) {
+            return nullptr;
+        }
+        memcpy(first, p, end - p);
+        return first + (end - p);
+    }
+
+    // 从first开始读取可选的负号和尽可能多的数字,返回第一个没有读取的位置;
+    // 没有数字时返回first且不改变*this
+    const char *from_chars(const char *first, const char *last)
+    {
+        const char *p = first;
+        bool minus = p != last && *p == '-';
+        if (minus) {
+            ++p;
+        }
+        if (p == last || *p < '0' || *p > '9') {
+            return first;
+        }
+        FixedBint value;
+        while (p != last && *p >= '0' && *p <= '9') {
+            // 攒够19位再乘进去
+            word_t chunk = 0, scale = 1;
+            for (int i = 0; i < CHUNK_DIGITS && p != last && *p >= '0' && *p <= '9'; ++i, ++p) {
+                chunk = chunk * 10 + (*p - '0');
+                scale *= 10;
+            }
+            value._MulAdd(scale, chunk);
+        }
+        if (minus) {
+            value._Negate();
+        }
+        *this = value;
+        return p;
+    }
+
+    // 跳过空白后读取可选的负号和数字,没有数字时设置failbit
+    friend std::istream &operator>>(std::istream &is, FixedBint &x)
+    {
+        typedef std::char_traits<char> traits;
+        std::istream::sentry sentry(is);
+        if (!sentry) {
+            return is;
+        }
+        std::streambuf *buf = is.rdbuf();
+        FixedBint value;
+        bool minus = false, any = false;
+        traits::int_type c = buf->sgetc();
+        if (traits::eq_int_type(c, traits::to_int_type('-'))) {
+            minus = true;
+            c = buf->snextc();
+        }
+        for (; !traits::eq_int_type(c, traits::eof()) && c >= '0' && c <= '9'; c = buf->snextc()) {
+            value._MulAdd(10, c - '0');
+            any = true;
+        }
+        if (traits::eq_int_type(c, traits::eof())) {
+            is.setstate(std::ios::eofbit);
+        }
+        if (!any) {
+            is.setstate(std::ios::failbit);
+            return is;
+        }
+        if (minus) {
+            value._Negate();
+        }
+        x = value;
+        return is;
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const FixedBint &x)
+    {
+        char buffer[MAX_CHARS];
+        char *last = x.to_chars(buffer, buffer + MAX_CHARS);
+        // 设置了宽度时交给流去填充
+        if (os.width() > 0) {
+            return os << std::string(buffer, last);
+        }
+        return os.write(buffer, last - buffer);
+    }
+};
+}
+
+#endif
@@ -4,34 +4,419 @@
 #include "exceptions.h"
 
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifdef SJTU_DEQUE_TRACE
+#include <chrono>
+#endif
 
-// T没有默认构造函数
 namespace sjtu {
+    // 结构操作的种类,供跟踪钩子区分
+    enum class trace_op {
+        split, merge, double_space, block_alloc, block_free, clear, rebalance, clone
+    };
+
+#ifdef SJTU_DEQUE_TRACE
+    /**
+     * 跟踪回调:操作种类、涉及的两个规模参数和耗时(纳秒).
+     * 规模参数:split/double_space为(size, capacity),merge为(左块size, 右块size),
+     * block_alloc为(capacity, 0),block_free为(size, capacity),clear/rebalance为(元素数, 块数),
+     * clone(写入仍被快照共享的块前复制槽位数组)为(size, capacity).
+     */
+    typedef void (*trace_handler)(trace_op op, size_t size1, size_t size2, long long nanoseconds);
+
+    inline trace_handler &current_trace_handler() {
+        static trace_handler handler = nullptr;
+        return handler;
+    }
+
+    inline void set_trace_handler(trace_handler handler) {
+        current_trace_handler() = handler;
+    }
+
+    // 构造时计时,析构时回调
+    class trace_scope {
+        trace_op op;
+        size_t size1, size2;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        trace_scope(trace_op op, size_t size1, size_t size2): op(op), size1(size1), size2(size2),
+                                                              start(std::chrono::steady_clock::now()) {
+        }
+
+        ~trace_scope() {
+            trace_handler handler = current_trace_handler();
+            if (handler != nullptr) {
+                handler(op, size1, size2, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start).count());
+            }
+        }
+    };
+
+    /**
+     * 按操作种类统计耗时的直方图,第k个桶记录耗时在[2^k, 2^(k+1))纳秒内的次数.
+     * 可直接作为回调:set_trace_handler(trace_histogram::record).
+     * 与deque本身一样不是线程安全的.
+     */
+    class trace_histogram {
+    public:
+        static const int kinds = 8;
+        static const int buckets = 40;
+        size_t count[kinds][buckets];
+        long long total_nanoseconds[kinds];
+
+        trace_histogram() {
+            reset();
+        }
+
+        void reset() {
+            for (int i = 0; i < kinds; i++) {
+                for (int j = 0; j < buckets; j++) {
+                    count[i][j] = 0;
+                }
+                total_nanoseconds[i] = 0;
+            }
+        }
+
+        void add(trace_op op, long long nanoseconds) {
+            int k = 0;
+            while (k + 1 < buckets && (nanoseconds >> (k + 1)) > 0) {
+                k++;
+            }
+            count[static_cast<int>(op)][k]++;
+            total_nanoseconds[static_cast<int>(op)] += nanoseconds;
+        }
+
+        static trace_histogram &global() {
+            static trace_histogram histogram;
+            return histogram;
+        }
+
+        static void record(trace_op op, size_t, size_t, long long nanoseconds) {
+            global().add(op, nanoseconds);
+        }
+    };
+
+#define SJTU_DEQUE_TRACE_SCOPE(op, size1, size2) sjtu::trace_scope sjtu_trace_scope_(op, size1, size2)
+#else
+    // 未定义SJTU_DEQUE_TRACE时钩子不产生任何代码
+#define SJTU_DEQUE_TRACE_SCOPE(op, size1, size2) ((void) 0)
+#endif
+
+    /**
+     * 块内槽位的存储方式.
+     * 平凡可复制的元素直接存放在块的循环数组里,析构时无需逐个处理;
+     * 其余元素单独分配在堆上,槽位只存指针.
+     * 两种槽位本身都是平凡可复制的,因此块内平移和块间迁移都可以整段memmove/memcpy.
+     */
+    template<class T, bool Inline = std::is_trivially_copyable<T>::value>
+    struct deque_slot {
+        typedef T type;
+        static const bool owns_heap = false;
+
+        static T &ref(type &slot) {
+            return slot;
+        }
+
+        static const T &ref(const type &slot) {
+            return slot;
+        }
+
+        static void construct(type &slot, const T &value) {
+            new(&slot) T(value);
+        }
+
+        static void destroy(type &) {
+        }
+    };
+
     template<class T>
+    struct deque_slot<T, false> {
+        typedef T *type;
+        static const bool owns_heap = true;
+
+        static T &ref(type slot) {
+            return *slot;
+        }
+
+        static void construct(type &slot, const T &value) {
+            slot = new T(value);
+        }
+
+        static void destroy(type slot) {
+            delete slot;
+        }
+    };
+
+    /**
+     * save()写出的快照文件头,之后依次是block_count个uint64_t的块大小,
+     * 再按data_offset对齐后是全部元素的连续拷贝(本机字节序).
+     */
+    struct snapshot_header {
+        char magic[8];
+        uint64_t element_size;
+        uint64_t total_size;
+        uint64_t block_count;
+        uint64_t data_offset;
+
+        static const char *expected_magic() {
+            return "SJTUDEQ1";
+        }
+
+        static uint64_t dataOffset(uint64_t block_count) {
+            uint64_t offset = sizeof(snapshot_header) + block_count * sizeof(uint64_t);
+            return (offset + 63) / 64 * 64;
+        }
+
+        bool valid(size_t elem_size) const {
+            return memcmp(magic, expected_magic(), sizeof(magic)) == 0 && element_size == elem_size &&
+                   data_offset == dataOffset(block_count);
+        }
+    };
+
+    /**
+     * 块聚合使用的幺半群:value_type、单位元identity()、把元素变成聚合值的lift(x)
+     * 以及满足结合律的combine(a, b).下面三个是常用的,也可以自己提供.
+     */
+    template<class T>
+    struct sum_monoid {
+        typedef T value_type;
+
+        static T identity() {
+            return T();
+        }
+
+        static T lift(const T &x) {
+            return x;
+        }
+
+        static T combine(const T &a, const T &b) {
+            return a + b;
+        }
+    };
+
+    template<class T>
+    struct min_monoid {
+        typedef T value_type;
+
+        static T identity() {
+            return std::numeric_limits<T>::max();
+        }
+
+        static T lift(const T &x) {
+            return x;
+        }
+
+        static T combine(const T &a, const T &b) {
+            return b < a ? b : a;
+        }
+    };
+
+    template<class T>
+    struct max_monoid {
+        typedef T value_type;
+
+        static T identity() {
+            return std::numeric_limits<T>::lowest();
+        }
+
+        static T lift(const T &x) {
+            return x;
+        }
+
+        static T combine(const T &a, const T &b) {
+            return a < b ? b : a;
+        }
+    };
+
+    /**
+     * 每块缓存的聚合值,块被修改或交出可写引用时失效,查询时按需重算;Monoid为void时不占空间.
+     * 非const的at()/operator[]/迭代器交出引用的那一刻使所在块失效,
+     * 因此经由引用的写入必须在下一次range_query之前完成,之后再写入不会被察觉(与引用失效的规则相同);
+     * 需要在查询之后写入时重新取引用,或者用set().
+     */
+    template<class Monoid>
+    struct block_aggregate {
+        typename Monoid::value_type aggregate;
+        bool aggregate_valid;
+
+        block_aggregate(): aggregate(Monoid::identity()), aggregate_valid(false) {
+        }
+
+        void invalidate() {
+            aggregate_valid = false;
+        }
+    };
+
+    template<>
+    struct block_aggregate<void> {
+        void invalidate() {
+        }
+    };
+
+    // T没有默认构造函数
+    template<class T, class Monoid = void>
     class deque {
     public:
-        class Block {
+        typedef T value_type;
+        typedef deque_slot<T> slot;
+        typedef typename slot::type slot_type;
+
+        class Block : public block_aggregate<Monoid> {
         public:
-            T **data;
+            slot_type *data; // 前面紧挨着引用计数,snapshot()得到的deque之间共享同一个数组
             size_t capacity; // 当前块的容量。注意到数组元素的个数可以通过head和tail算出来
             size_t size;
             size_t head, tail; // 循环数组的头尾指针,尾指针在最后一个元素的后面
             Block *next;
             Block *pre;
 
-            Block(size_t capa = 128): capacity(capa), size(0), head(0), tail(0), pre(nullptr), next(nullptr) {
-                data = new T *[capacity];
-                for (size_t i = 0; i < capacity; i++) {
-                    data[i] = nullptr;
+            // 槽位数组的对齐:至少max_align_t,元素过度对齐时按元素的要求
+            static const size_t slot_align = alignof(slot_type) > alignof(std::max_align_t)
+                                                 ? alignof(slot_type)
+                                                 : alignof(std::max_align_t);
+
+#ifdef __STDCPP_DEFAULT_NEW_ALIGNMENT__
+            static const bool over_aligned = slot_align > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+#else
+            static const bool over_aligned = slot_align > alignof(std::max_align_t);
+#endif
+
+            // 引用计数占用的字节,向上取整到slot_align,使紧随其后的槽位数组同样对齐
+            static const size_t refs_bytes = (sizeof(std::atomic<size_t>) + slot_align - 1) / slot_align * slot_align;
+
+            // operator new只保证默认对齐,过度对齐的元素改用posix_memalign,释放时对应地用free
+            static slot_type *allocSlots(size_t capa) {
+                size_t bytes = refs_bytes + capa * sizeof(slot_type);
+                char *raw;
+                if (over_aligned) {
+                    void *p = nullptr;
+                    if (posix_memalign(&p, slot_align, bytes) != 0) {
+                        throw std::bad_alloc();
+                    }
+                    raw = static_cast<char *>(p);
+                } else {
+                    raw = static_cast<char *>(::operator new(bytes));
                 }
+                new(raw) std::atomic<size_t>(1);
+                return reinterpret_cast<slot_type *>(raw + refs_bytes);
+            }
+
+            static void freeSlots(slot_type *slots) {
+                char *raw = reinterpret_cast<char *>(slots) - refs_bytes;
+                if (over_aligned) {
+                    free(raw);
+                } else {
+                    ::operator delete(raw);
+                }
+            }
+
+            Block(size_t capa = 128): capacity(capa), size(0), head(0), tail(0), pre(nullptr), next(nullptr) {
+                data = allocSlots(capacity);
+            }
+
+            // 与other共享槽位数组,不复制链接
+            explicit Block(const Block &other): block_aggregate<Monoid>(other), data(other.data),
+                                                capacity(other.capacity), size(other.size), head(other.head),
+                                                tail(other.tail), next(nullptr), pre(nullptr) {
+                refs().fetch_add(1, std::memory_order_relaxed);
             }
 
             ~Block() {
-                for (size_t i = 0; i < size; i++) {
-                    delete data[(i + head) % capacity];
+                release();
+            }
+
+            std::atomic<size_t> &refs() const {
+                return *reinterpret_cast<std::atomic<size_t> *>(reinterpret_cast<char *>(data) - refs_bytes);
+            }
+
+            bool shared() const {
+                return refs().load(std::memory_order_acquire) > 1;
+            }
+
+            // 析构块内所有元素,循环数组分两段遍历;元素直接存放在块内时什么都不做
+            void destroyAll() {
+                if (slot::owns_heap) {
+                    size_t first = std::min(size, capacity - head);
+                    for (size_t i = head; i < head + first; i++) {
+                        slot::destroy(data[i]);
+                    }
+                    for (size_t i = 0; i < size - first; i++) {
+                        slot::destroy(data[i]);
+                    }
+                }
+            }
+
+            // 放弃对槽位数组的引用,最后一个引用者负责析构元素并释放
+            void release() {
+                if (refs().fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    destroyAll();
+                    freeSlots(data);
+                }
+            }
+
+            // 清空一个不共享的块以便复用,保留槽位数组
+            void reset() {
+                destroyAll();
+                size = head = tail = 0;
+                next = pre = nullptr;
+                this->invalidate();
+            }
+
+            // 块内第i个元素所在的槽位
+            slot_type &at(size_t i) {
+                return data[(head + i) % capacity];
+            }
+
+            const slot_type &at(size_t i) const {
+                return data[(head + i) % capacity];
+            }
+
+            // 把块内第from个起的count个槽位依次拷贝到dst,循环数组最多分成两段
+            void copyOut(size_t from, size_t count, slot_type *dst) const {
+                size_t start = (head + from) % capacity;
+                size_t first = std::min(count, capacity - start);
+                memcpy(dst, data + start, first * sizeof(slot_type));
+                memcpy(dst + first, data, (count - first) * sizeof(slot_type));
+            }
+
+            // 第idx个及以后的槽位整体后移一格,调用前块不能是满的
+            void shiftRight(size_t idx) {
+                size_t count = size - idx;
+                size_t start = (head + idx) % capacity;
+                if (start + count < capacity) {
+                    memmove(data + start + 1, data + start, count * sizeof(slot_type));
+                } else {
+                    memmove(data + 1, data, (start + count - capacity) * sizeof(slot_type));
+                    memcpy(data, data + capacity - 1, sizeof(slot_type));
+                    memmove(data + start + 1, data + start, (capacity - 1 - start) * sizeof(slot_type));
+                }
+            }
+
+            // 第idx个以后的槽位整体前移一格,覆盖第idx个
+            void shiftLeft(size_t idx) {
+                size_t count = size - 1 - idx;
+                size_t start = (head + idx) % capacity;
+                if (start + count < capacity) {
+                    memmove(data + start, data + start + 1, count * sizeof(slot_type));
+                } else {
+                    memmove(data + start, data + start + 1, (capacity - 1 - start) * sizeof(slot_type));
+                    memcpy(data + capacity - 1, data, sizeof(slot_type));
+                    memmove(data, data + 1, (start + count - capacity) * sizeof(slot_type));
                 }
-                delete[] data;
             }
 
             size_t get_size() const {
@@ -53,25 +438,148 @@ namespace sjtu {
         size_t total_size; // 总元素数量
         size_t block_count; // 块的数量
 
+        // 自构造以来的结构操作计数,供stats()使用
+        size_t split_count;
+        size_t merge_count;
+        size_t double_count;
+        size_t alloc_count; // 堆分配次数(块头、槽位数组和堆上的元素各算一次)
+        size_t clone_count; // 写入共享块前复制槽位数组的次数
+
+        // reserve_front/reserve_back预留的空块,用next串成单链表,newBlock优先从这里取
+        Block *spare_block;
+        size_t spare_slots; // 预留空块的容量之和
+        size_t size_hint; // 预留时预期达到的规模,块容量按它和当前规模中较大的计算;达到后或clear()时归零
+
+        /**
+         * 内存占用与结构统计.
+         * 所有字段都由块链表一次遍历得到,代价是O(block_count).
+         */
+        struct stats_type {
+            size_t size; // 元素数量
+            size_t block_count;
+            size_t element_bytes; // 单独分配在堆上的元素,元素直接存放在块内时为0
+            size_t slot_bytes; // 各块循环数组的槽位,按容量计;与快照共享的数组在每一方都计入
+            size_t header_bytes; // Block对象本身
+            size_t total_bytes;
+            size_t fill[4]; // 填充率落在[0,25%),[25%,50%),[50%,75%),[75%,100%]的块数
+            size_t shared_blocks; // 槽位数组仍与快照共享的块数
+            size_t spare_blocks; // 预留尚未使用的空块,字节数计入slot_bytes和header_bytes
+            size_t splits;
+            size_t merges;
+            size_t doublings;
+            size_t allocations;
+            size_t clones;
+        };
+
+        Block *newBlock(size_t capa) {
+            if (spare_block != nullptr && spare_block->capacity >= capa) {
+                return takeSpare();
+            }
+            SJTU_DEQUE_TRACE_SCOPE(trace_op::block_alloc, capa, 0);
+            alloc_count += 2;
+            return new Block(capa);
+        }
+
+        Block *takeSpare() {
+            Block *block = spare_block;
+            spare_block = block->next;
+            spare_slots -= block->capacity;
+            block->next = nullptr;
+            return block;
+        }
+
+        void releaseSpares() {
+            while (spare_block != nullptr) {
+                freeBlock(takeSpare());
+            }
+        }
+
+        // 预留空块直到一端的空余槽位加上所有预留块的容量不少于n.
+        // 先按新的预期规模重新平衡,并把端块扩到理想容量,否则之后插入时
+        // 合并小块(包括写满的端块和接在旁边的预留块)会把预留块当作新块取走
+        void reserveEnd(size_t n, bool back) {
+            size_hint = std::max(size_hint, total_size + n);
+            check();
+            Block *end = back ? tail_block : head_block;
+            while (end != nullptr && end->capacity < idealCapacity()) {
+                doubleSpace(end);
+            }
+            size_t room = spare_slots + (end != nullptr ? end->capacity - end->size : 0);
+            size_t capa = idealCapacity();
+            while (room < n) {
+                SJTU_DEQUE_TRACE_SCOPE(trace_op::block_alloc, capa, 0);
+                alloc_count += 2;
+                Block *block = new Block(capa);
+                block->next = spare_block;
+                spare_block = block;
+                spare_slots += capa;
+                room += capa;
+            }
+        }
+
+        // 规模达到预留时的预期后预留已经用完,此后块容量和分裂合并的阈值按实际规模计算
+        void reachHint() {
+            if (total_size >= size_hint) {
+                size_hint = 0;
+            }
+        }
+
+        void freeBlock(Block *block) {
+            SJTU_DEQUE_TRACE_SCOPE(trace_op::block_free, block->size, block->capacity);
+            delete block;
+        }
+
+        void construct(slot_type &target, const T &value) {
+            if (slot::owns_heap) {
+                alloc_count++;
+            }
+            slot::construct(target, value);
+        }
+
+        // 写入块之前调用:使块的聚合缓存失效;槽位数组仍被快照共享时先复制一份自己的,块本身不变
+        void own(Block *block) {
+            block->invalidate();
+            if (!block->shared()) {
+                return;
+            }
+            SJTU_DEQUE_TRACE_SCOPE(trace_op::clone, block->size, block->capacity);
+            slot_type *copy = Block::allocSlots(block->capacity);
+            alloc_count++;
+            if (slot::owns_heap) {
+                for (size_t i = 0; i < block->size; i++) {
+                    size_t pos = (block->head + i) % block->capacity;
+                    construct(copy[pos], slot::ref(block->data[pos]));
+                }
+            } else {
+                size_t first = std::min(block->size, block->capacity - block->head);
+                memcpy(copy + block->head, block->data + block->head, first * sizeof(slot_type));
+                memcpy(copy, block->data, (block->size - first) * sizeof(slot_type));
+            }
+            block->release();
+            block->data = copy;
+            clone_count++;
+        }
+
         // 理想的块容量 2\sqrt{n}
+        static size_t idealCapacity(size_t n) {
+            return std::max(static_cast<size_t>(2 * std::sqrt(n)), static_cast<size_t>(128));
+        }
+
         size_t idealCapacity() const {
-            return std::max(static_cast<size_t>(2 * std::sqrt(total_size)), static_cast<size_t>(128));
+            return idealCapacity(std::max(total_size, size_hint));
         }
 
         // 块分裂
         void splitBlock(Block *block) {
-            Block *new_block = new Block(block->capacity);
+            SJTU_DEQUE_TRACE_SCOPE(trace_op::split, block->size, block->capacity);
+            own(block);
+            Block *new_block = newBlock(block->capacity);
             size_t mid = (block->size) >> 1;
 
-            // 迁移后面一半的元素到新块中,但是必须重新分配内存
-            for (size_t i = 0; i < (block->size % 2 == 0 ? mid : mid + 1); i++) {
-                T *temp = block->data[(block->head + i + mid) % block->capacity];
-                new_block->data[new_block->tail++] = new T(*temp);
-                delete temp;
-                block->data[(block->head + i + mid
-                            ) % block->capacity] = nullptr;
-            }
+            // 后面一半的槽位整段迁移到新块中,元素本身不需要重新分配
+            block->copyOut(mid, block->size - mid, new_block->data);
             new_block->size = block->size - mid;
+            new_block->tail = new_block->size;
             block->tail = (block->head + mid) % block->capacity;
             block->size = mid;
 
@@ -88,24 +596,21 @@ namespace sjtu {
                 tail_block = new_block;
             }
             block_count++;
+            split_count++;
         }
 
         // 合并块
         Block *mergeBlock(Block *left, Block *right) {
+            SJTU_DEQUE_TRACE_SCOPE(trace_op::merge, left->size, right->size);
+            own(left);
+            own(right);
             size_t new_size = left->size + right->size;
             size_t p = static_cast<size_t>(log2(new_size)) + 1;
-            Block *new_block = new Block(static_cast<size_t>(std::pow(2, p)));
-            for (size_t i = 0; i < left->size; i++) {
-                T *temp = left->data[(left->head + i) % left->capacity];
-                new_block->data[new_block->tail++] = new T(*temp);
-            }
-            for (size_t i = 0; i < right->size; i++) {
-                T *temp = right->data[(right->head + i) % right->capacity];
-                new_block->data[new_block->tail++] = new T(*temp);
-                // delete temp;
-                // right->data[(right->head + i) % right->capacity] = nullptr;
-            }
-            new_block->size = left->size + right->size;
+            Block *new_block = newBlock(static_cast<size_t>(std::pow(2, p)));
+            left->copyOut(0, left->size, new_block->data);
+            right->copyOut(0, right->size, new_block->data + left->size);
+            new_block->size = new_size;
+            new_block->tail = new_size;
             new_block->next = right->next;
             new_block->pre = left->pre;
             if (left->pre != nullptr) {
@@ -122,46 +627,52 @@ namespace sjtu {
                 tail_block = new_block;
             }
 
-            // delete[] left->data;
-            // delete[] right->data;
-            delete left;
-            delete right;
+            // 元素已经归新块所有
+            left->size = right->size = 0;
+            freeBlock(left);
+            freeBlock(right);
             block_count--;
+            merge_count++;
             return new_block;
         }
 
-        // 容积扩充,且block不失效
+        // 容积扩充:只换掉槽位数组,块头和前后链接不变,指向该块的迭代器仍然有效
         Block *doubleSpace(Block *block) {
+            SJTU_DEQUE_TRACE_SCOPE(trace_op::double_space, block->size, block->capacity);
+            block->invalidate();
             size_t new_capacity = block->capacity << 1;
-            Block *new_block = new Block(new_capacity);
-            for (size_t i = 0; i < block->size; i++) {
-                T *temp = block->data[(block->head + i) % block->capacity];
-                new_block->data[new_block->tail++] = new T(*temp);
-                // delete temp;
-                // block->data[(block->head + i) % block->capacity] = nullptr;
-            }
-            new_block->size = block->size;
-            new_block->next = block->next;
-            new_block->pre = block->pre;
-            if (block->pre != nullptr) {
-                block->pre->next = new_block;
-            }
-            if (block->next != nullptr) {
-                block->next->pre = new_block;
-            }
-            if (block == head_block) {
-                head_block = new_block;
-            }
-            if (block == tail_block) {
-                tail_block = new_block;
-            }
-
-            // delete[] block->data;
-            delete block;
-            return new_block;
+            slot_type *grown = Block::allocSlots(new_capacity);
+            alloc_count++;
+            // 数组仍被快照共享时直接复制进新数组,不必先own()再搬一次
+            bool shared = block->shared();
+            if (shared && slot::owns_heap) {
+                for (size_t i = 0; i < block->size; i++) {
+                    construct(grown[i], slot::ref(block->at(i)));
+                }
+            } else {
+                block->copyOut(0, block->size, grown);
+            }
+            if (shared) {
+                clone_count++;
+            }
+
+            // 独占时槽位已经归新数组所有,释放旧数组时不能再析构元素
+            size_t size = block->size;
+            if (!shared) {
+                block->size = 0;
+            }
+            block->release();
+            block->data = grown;
+            block->capacity = new_capacity;
+            block->size = size;
+            block->head = 0;
+            block->tail = size;
+            double_count++;
+            return block;
         }
 
         void check() {
+            SJTU_DEQUE_TRACE_SCOPE(trace_op::rebalance, total_size, block_count);
             if (block_count > 1) {
                 Block *current = head_block;
                 if (current->size > 4 * idealCapacity()) {
@@ -366,14 +877,15 @@ namespace sjtu {
                     throw container_is_empty();
                     // throw "1";
                 }
-                return *cur_block->data[(index + cur_block->head) % cur_block->capacity];
+                parent->own(cur_block);
+                return slot::ref(cur_block->at(index));
                 // index+cur_block->head才是真正的索引
             }
 
             /**
              * it->field
              */
-            T *operator->() const noexcept {
+            T *operator->() const {
                 return &(operator*());
             }
 
@@ -571,10 +1083,10 @@ namespace sjtu {
                     throw container_is_empty();
                     // throw "1";
                 }
-                return *cur_block->data[(index + cur_block->head) % cur_block->capacity];
+                return slot::ref(cur_block->at(index));
             }
 
-            const T *operator->() const noexcept {
+            const T *operator->() const {
                 return &(operator*());
             }
 
@@ -610,7 +1122,9 @@ namespace sjtu {
         /**
          * constructors.
          */
-        deque(): head_block(nullptr), tail_block(nullptr), total_size(0), block_count(0) {
+        deque(): head_block(nullptr), tail_block(nullptr), total_size(0), block_count(0), split_count(0),
+                 merge_count(0), double_count(0), alloc_count(0), clone_count(0), spare_block(nullptr),
+                 spare_slots(0), size_hint(0) {
         }
 
         deque(const deque &other): deque() {
@@ -619,12 +1133,16 @@ namespace sjtu {
             }
         }
 
+        deque(deque &&other) noexcept: deque() {
+            swap(other);
+        }
+
         /**
          * deconstructor.
          */
         ~deque() {
-            // std::cout<<"~deque()"<<std::endl;
-            clear();
+            clear(false);
+            releaseSpares();
         }
 
         /**
@@ -641,6 +1159,60 @@ namespace sjtu {
             return *this;
         }
 
+        deque &operator=(deque &&other) noexcept {
+            if (this != &other) {
+                clear();
+                swap(other);
+            }
+            return *this;
+        }
+
+        // 只交换块链表和元素,统计计数与预留块各自保留
+        void swapContents(deque &other) noexcept {
+            std::swap(head_block, other.head_block);
+            std::swap(tail_block, other.tail_block);
+            std::swap(total_size, other.total_size);
+            std::swap(block_count, other.block_count);
+        }
+
+        void swap(deque &other) noexcept {
+            swapContents(other);
+            std::swap(split_count, other.split_count);
+            std::swap(merge_count, other.merge_count);
+            std::swap(double_count, other.double_count);
+            std::swap(alloc_count, other.alloc_count);
+            std::swap(clone_count, other.clone_count);
+            std::swap(spare_block, other.spare_block);
+            std::swap(spare_slots, other.spare_slots);
+            std::swap(size_hint, other.size_hint);
+        }
+
+        /**
+         * return a copy that shares every block's storage with this deque, in
+         * O(block_count). whichever side first writes to a shared block clones
+         * it; the other keeps seeing the old contents. the reference counts are
+         * atomic, so the copy may be read and destroyed on another thread while
+         * this deque keeps changing. references to elements obtained before the
+         * snapshot still alias the shared storage.
+         */
+        deque snapshot() const {
+            deque result;
+            for (Block *current = head_block; current != nullptr; current = current->next) {
+                Block *block = new Block(*current);
+                result.alloc_count++;
+                block->pre = result.tail_block;
+                if (result.tail_block != nullptr) {
+                    result.tail_block->next = block;
+                } else {
+                    result.head_block = block;
+                }
+                result.tail_block = block;
+            }
+            result.total_size = total_size;
+            result.block_count = block_count;
+            return result;
+        }
+
         /**
          * access a specified element with bound checking.
          * throw index_out_of_bound if out of bound.
@@ -655,7 +1227,8 @@ namespace sjtu {
                 sum += current->size;
                 current = current->next;
             }
-            return *current->data[(pos + current->head - sum) % current->capacity];
+            own(current);
+            return slot::ref(current->at(pos - sum));
         }
 
         const T &at(const size_t &pos) const {
@@ -668,7 +1241,7 @@ namespace sjtu {
                 sum += current->size;
                 current = current->next;
             }
-            return *current->data[(pos + current->head - sum) % current->capacity];
+            return slot::ref(current->at(pos - sum));
         }
 
         T &operator[](const size_t &pos) {
@@ -679,6 +1252,26 @@ namespace sjtu {
             return at(pos);
         }
 
+        /**
+         * overwrite a specified element with bound checking. unlike a reference
+         * from the non-const at()/operator[]/iterator, this is never stale with
+         * respect to range_query, whenever it happens.
+         * throw index_out_of_bound if out of bound.
+         */
+        void set(const size_t &pos, const T &value) {
+            if (pos >= total_size) {
+                throw index_out_of_bound();
+            }
+            Block *current = head_block;
+            size_t sum = 0;
+            while (sum + current->size <= pos) {
+                sum += current->size;
+                current = current->next;
+            }
+            own(current);
+            slot::ref(current->at(pos - sum)) = value;
+        }
+
         /**
          * access the first element.
          * throw container_is_empty when the container is empty.
@@ -687,7 +1280,7 @@ namespace sjtu {
             if (empty()) {
                 throw container_is_empty();
             }
-            return *head_block->data[head_block->head];
+            return slot::ref(head_block->at(0));
         }
 
         /**
@@ -699,7 +1292,7 @@ namespace sjtu {
                 throw container_is_empty();
                 // throw "1";
             }
-            return *tail_block->data[(tail_block->head + tail_block->size - 1) % tail_block->capacity];
+            return slot::ref(tail_block->at(tail_block->size - 1));
         }
 
         /**
@@ -752,21 +1345,290 @@ namespace sjtu {
             return total_size;
         }
 
+        // 块的聚合值,缓存失效时重算;写成模板使Monoid为void时不实例化
+        template<class M = Monoid>
+        const typename M::value_type &blockAggregate(Block *block) const {
+            if (!block->aggregate_valid) {
+                typename M::value_type result = M::identity();
+                for (size_t i = 0; i < block->size; i++) {
+                    result = M::combine(result, M::lift(slot::ref(block->at(i))));
+                }
+                block->aggregate = result;
+                block->aggregate_valid = true;
+            }
+            return block->aggregate;
+        }
+
+        /**
+         * combine the elements in [l, r) with Monoid, in order.
+         * whole blocks use their cached aggregate, so the cost is O(sqrt n)
+         * plus O(block size) for every block written to, or handed out a mutable
+         * reference, since it was last queried. writes through a reference must
+         * happen before the next query (see block_aggregate).
+         * throw index_out_of_bound if the range is invalid.
+         */
+        template<class M = Monoid>
+        typename M::value_type range_query(const size_t &l, const size_t &r) const {
+            if (l > r || r > total_size) {
+                throw index_out_of_bound();
+            }
+            typename M::value_type result = M::identity();
+            size_t cur = 0;
+            for (Block *current = head_block; current != nullptr && cur < r; current = current->next) {
+                size_t from = l > cur ? l - cur : 0;
+                size_t to = std::min(current->size, r - cur);
+                if (from == 0 && to == current->size) {
+                    result = M::combine(result, blockAggregate(current));
+                } else {
+                    for (size_t i = from; i < to; i++) {
+                        result = M::combine(result, M::lift(slot::ref(current->at(i))));
+                    }
+                }
+                cur += current->size;
+            }
+            return result;
+        }
+
         /**
-         * clear all contents.
+         * return the memory footprint and structural counters.
          */
-        void clear() {
-            // std::cout<<"clear()"<<std::endl;
+        stats_type stats() const {
+            stats_type result = stats_type();
+            result.size = total_size;
+            result.block_count = block_count;
+            result.element_bytes = slot::owns_heap ? total_size * sizeof(T) : 0;
+            result.header_bytes = block_count * sizeof(Block);
+            for (Block *current = head_block; current != nullptr; current = current->next) {
+                result.slot_bytes += Block::refs_bytes + current->capacity * sizeof(slot_type);
+                result.shared_blocks += current->shared();
+                size_t quarter = 4 * current->size / current->capacity;
+                result.fill[quarter < 3 ? quarter : 3]++;
+            }
+            for (Block *current = spare_block; current != nullptr; current = current->next) {
+                result.slot_bytes += Block::refs_bytes + current->capacity * sizeof(slot_type);
+                result.header_bytes += sizeof(Block);
+                result.spare_blocks++;
+            }
+            result.total_bytes = result.element_bytes + result.slot_bytes + result.header_bytes;
+            result.splits = split_count;
+            result.merges = merge_count;
+            result.doublings = double_count;
+            result.allocations = alloc_count;
+            result.clones = clone_count;
+            return result;
+        }
+
+        /**
+         * return the number of bytes held by the container.
+         */
+        size_t memory_usage() const {
+            return stats().total_bytes;
+        }
+
+        /**
+         * return the number of elements the allocated blocks can hold,
+         * including blocks set aside by reserve_front/reserve_back.
+         */
+        size_t capacity() const {
+            size_t result = spare_slots;
+            for (Block *current = head_block; current != nullptr; current = current->next) {
+                result += current->capacity;
+            }
+            return result;
+        }
+
+        /**
+         * set aside empty blocks so that the next n push_back calls find a
+         * block ready instead of allocating. blocks are sized, and the deque
+         * is balanced, for the size after those pushes, until the deque reaches
+         * that size or is cleared. the reserved blocks serve both ends, are
+         * kept across clear() and are freed by shrink_to_fit().
+         */
+        void reserve_back(size_t n) {
+            reserveEnd(n, true);
+        }
+
+        /**
+         * the same as reserve_back, for push_front.
+         */
+        void reserve_front(size_t n) {
+            reserveEnd(n, false);
+        }
+
+        /**
+         * free reserved blocks and move the elements into full blocks of the
+         * ideal capacity for the current size, in O(n).
+         */
+        void shrink_to_fit() {
+            releaseSpares();
+            size_hint = 0;
+            size_t capa = idealCapacity();
+            Block *current = head_block;
+            head_block = tail_block = nullptr;
+            block_count = 0;
+            while (current != nullptr) {
+                own(current);
+                size_t from = 0;
+                while (from < current->size) {
+                    if (tail_block == nullptr || tail_block->isFull()) {
+                        Block *block = newBlock(capa);
+                        block->pre = tail_block;
+                        (tail_block != nullptr ? tail_block->next : head_block) = block;
+                        tail_block = block;
+                        block_count++;
+                    }
+                    size_t count = std::min(current->size - from, tail_block->capacity - tail_block->size);
+                    current->copyOut(from, count, tail_block->data + tail_block->size);
+                    tail_block->size += count;
+                    tail_block->tail = tail_block->size % tail_block->capacity;
+                    from += count;
+                }
+                // 槽位已经归新块所有
+                Block *next = current->next;
+                current->size = 0;
+                freeBlock(current);
+                current = next;
+            }
+        }
+
+        /**
+         * write all elements to path, block by block as contiguous segments.
+         * only for trivially copyable T. throw runtime_error on I/O failure.
+         */
+        void save(const std::string &path) const {
+            static_assert(!slot::owns_heap, "save requires a trivially copyable element type");
+            FILE *file = fopen(path.c_str(), "wb");
+            if (file == nullptr) {
+                throw runtime_error();
+            }
+            snapshot_header header;
+            memcpy(header.magic, snapshot_header::expected_magic(), sizeof(header.magic));
+            header.element_size = sizeof(T);
+            header.total_size = total_size;
+            header.block_count = block_count;
+            header.data_offset = snapshot_header::dataOffset(block_count);
+            bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+            for (Block *current = head_block; ok && current != nullptr; current = current->next) {
+                uint64_t size = current->size;
+                ok = fwrite(&size, sizeof(size), 1, file) == 1;
+            }
+            static const char padding[64] = {};
+            size_t written = sizeof(header) + block_count * sizeof(uint64_t);
+            ok = ok && fwrite(padding, 1, header.data_offset - written, file) == header.data_offset - written;
+            for (Block *current = head_block; ok && current != nullptr; current = current->next) {
+                size_t first = std::min(current->size, current->capacity - current->head);
+                ok = fwrite(current->data + current->head, sizeof(T), first, file) == first &&
+                     fwrite(current->data, sizeof(T), current->size - first, file) == current->size - first;
+            }
+            if (fclose(file) != 0 || !ok) {
+                throw runtime_error();
+            }
+        }
+
+        /**
+         * replace the contents with a file written by save(), rebuilding the
+         * saved block layout directly instead of pushing element by element.
+         * the counts in the header are checked against the file size first,
+         * and the contents are only replaced once the whole file has been read.
+         * throw runtime_error if the file cannot be read or does not match T.
+         */
+        void load(const std::string &path) {
+            static_assert(!slot::owns_heap, "load requires a trivially copyable element type");
+            std::unique_ptr<FILE, int (*)(FILE *)> file(fopen(path.c_str(), "rb"), fclose);
+            if (file == nullptr) {
+                throw runtime_error();
+            }
+            long file_size = -1;
+            if (fseek(file.get(), 0, SEEK_END) == 0) {
+                file_size = ftell(file.get());
+            }
+            snapshot_header header;
+            if (file_size < static_cast<long>(sizeof(header)) || fseek(file.get(), 0, SEEK_SET) != 0 ||
+                fread(&header, sizeof(header), 1, file.get()) != 1) {
+                throw runtime_error();
+            }
+            // 文件头里的数量都不可信,分配之前先用文件大小约束
+            uint64_t length = static_cast<uint64_t>(file_size);
+            if (header.block_count > (length - sizeof(header)) / sizeof(uint64_t) || !header.valid(sizeof(T)) ||
+                header.data_offset > length || header.total_size > (length - header.data_offset) / sizeof(T)) {
+                throw runtime_error();
+            }
+            std::vector<uint64_t> sizes(static_cast<size_t>(header.block_count));
+            bool ok = fread(sizes.data(), sizeof(uint64_t), sizes.size(), file.get()) == sizes.size() &&
+                      fseek(file.get(), static_cast<long>(header.data_offset), SEEK_SET) == 0;
+            uint64_t sum = 0;
+            for (size_t i = 0; ok && i < sizes.size(); i++) {
+                ok = sizes[i] <= header.total_size - sum;
+                sum += sizes[i];
+            }
+            if (!ok || sum != header.total_size) {
+                throw runtime_error();
+            }
+            // 先读进临时的deque,读取失败时原有内容不受影响
+            deque result;
+            for (size_t i = 0; ok && i < sizes.size(); i++) {
+                if (sizes[i] == 0) {
+                    continue;
+                }
+                size_t capacity = 128;
+                while (capacity < sizes[i]) {
+                    capacity <<= 1;
+                }
+                Block *block = result.newBlock(capacity);
+                ok = fread(block->data, sizeof(T), sizes[i], file.get()) == sizes[i];
+                block->size = ok ? sizes[i] : 0;
+                block->tail = block->size % capacity;
+                block->pre = result.tail_block;
+                if (result.tail_block != nullptr) {
+                    result.tail_block->next = block;
+                } else {
+                    result.head_block = block;
+                }
+                result.tail_block = block;
+                result.block_count++;
+            }
+            if (!ok) {
+                throw runtime_error();
+            }
+            result.total_size = header.total_size;
+            swapContents(result);
+            alloc_count += result.alloc_count;
+        }
+
+        /**
+         * clear all contents. unless blocks are already reserved or keep_block
+         * is false, the largest block is kept (emptied) for the next insertion;
+         * pass false to return all of the memory except reserved blocks.
+         * trivially copyable elements are not destroyed one by one, so this is
+         * O(block_count).
+         */
+        void clear(bool keep_block = true) {
+            SJTU_DEQUE_TRACE_SCOPE(trace_op::clear, total_size, block_count);
+            // 没有预留块时留下容量最大的一个不共享的块,清空后再次插入不必重新分配
+            Block *keep = nullptr;
             Block *current = head_block;
             while (current != nullptr) {
                 Block *next = current->next;
-                delete current;
+                if (keep_block && spare_block == nullptr && !current->shared() &&
+                    (keep == nullptr || current->capacity > keep->capacity)) {
+                    std::swap(keep, current);
+                }
+                if (current != nullptr) {
+                    freeBlock(current);
+                }
                 current = next;
             }
+            if (keep != nullptr) {
+                keep->reset();
+                keep->next = spare_block;
+                spare_block = keep;
+                spare_slots += keep->capacity;
+            }
             head_block = nullptr;
             tail_block = nullptr;
             total_size = 0;
             block_count = 0;
+            size_hint = 0;
         }
 
         /**
@@ -815,16 +1677,13 @@ namespace sjtu {
                 }
             }
 
-            size_t actual_pos = (block->head + idx) % block->capacity;
-            for (size_t i = block->size; i > idx; i--) {
-                size_t t1 = (block->head + i + block->capacity - 1) % block->capacity;
-                size_t t2 = (block->head + i) % block->capacity;
-                block->data[t2] = block->data[t1];
-            }
-            block->data[actual_pos] = new T(value);
+            own(block);
+            block->shiftRight(idx);
+            construct(block->at(idx), value);
             block->size++;
             block->tail = (block->tail + 1) % block->capacity;
             total_size++;
+            reachHint();
 
             // 检查分裂和合并
             if (block_count > 1) {
@@ -886,16 +1745,10 @@ namespace sjtu {
             Block *block = pos.cur_block;
             size_t idx = pos.index;
 
-            size_t actual_pos = (block->head + idx) % block->capacity;
-            delete block->data[actual_pos];
-            block->data[actual_pos] = nullptr;
-            for (size_t i = idx; i < block->size - 1; i++) {
-                size_t t1 = (block->head + i) % block->capacity;
-                size_t t2 = (block->head + i + 1) % block->capacity;
-                block->data[t1] = block->data[t2];
-            }
+            own(block);
+            slot::destroy(block->at(idx));
+            block->shiftLeft(idx);
             block->tail = (block->tail + block->capacity - 1) % block->capacity;
-            block->data[block->tail] = nullptr;
             block->size--;
             total_size--;
 
@@ -970,7 +1823,7 @@ namespace sjtu {
         void push_back(const T &value) {
             if (empty()) {
                 size_t cap = idealCapacity();
-                head_block = tail_block = new Block(cap);
+                head_block = tail_block = newBlock(cap);
                 block_count++;
             }
 
@@ -979,17 +1832,26 @@ namespace sjtu {
             }
 
             if (tail_block->isFull()) {
-                if (tail_block->capacity < idealCapacity()) {
+                if (spare_block != nullptr) {
+                    // 有预留块时直接接到尾部,不必分裂搬走一半元素
+                    Block *block = takeSpare();
+                    block->pre = tail_block;
+                    tail_block->next = block;
+                    tail_block = block;
+                    block_count++;
+                } else if (tail_block->capacity < idealCapacity()) {
                     doubleSpace(tail_block);
                 } else {
                     splitBlock(tail_block);
                 }
             }
 
-            tail_block->data[tail_block->tail] = new T(value);
+            own(tail_block);
+            construct(tail_block->data[tail_block->tail], value);
             tail_block->tail = (tail_block->tail + 1) % tail_block->capacity;
             tail_block->size++;
             total_size++;
+            reachHint();
 
             check();
         }
@@ -1004,9 +1866,9 @@ namespace sjtu {
                 // throw "1";
             }
 
+            own(tail_block);
             size_t delete_pos = (tail_block->tail + tail_block->capacity - 1) % tail_block->capacity;
-            delete tail_block->data[delete_pos];
-            tail_block->data[delete_pos] = nullptr;
+            slot::destroy(tail_block->data[delete_pos]);
             tail_block->tail = delete_pos;
             tail_block->size--;
             total_size--;
@@ -1029,7 +1891,7 @@ namespace sjtu {
         void push_front(const T &value) {
             if (empty()) {
                 size_t cap = idealCapacity();
-                head_block = tail_block = new Block(cap);
+                head_block = tail_block = newBlock(cap);
                 block_count++;
             }
 
@@ -1038,17 +1900,25 @@ namespace sjtu {
             }
 
             if (head_block->isFull()) {
-                if (head_block->capacity < idealCapacity()) {
+                if (spare_block != nullptr) {
+                    Block *block = takeSpare();
+                    block->next = head_block;
+                    head_block->pre = block;
+                    head_block = block;
+                    block_count++;
+                } else if (head_block->capacity < idealCapacity()) {
                     doubleSpace(head_block);
                 } else {
                     splitBlock(head_block);
                 }
             }
 
+            own(head_block);
             head_block->head = (head_block->head + head_block->capacity - 1) % head_block->capacity;
-            head_block->data[head_block->head] = new T(value);
+            construct(head_block->data[head_block->head], value);
             head_block->size++;
             total_size++;
+            reachHint();
 
             check();
         }
@@ -1063,8 +1933,8 @@ namespace sjtu {
                 // throw "1";
             }
 
-            delete head_block->data[head_block->head];
-            head_block->data[head_block->head] = nullptr;
+            own(head_block);
+            slot::destroy(head_block->data[head_block->head]);
             head_block->head = (head_block->head + 1) % head_block->capacity;
             head_block->size--;
             total_size--;
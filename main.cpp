@@ -3,11 +3,24 @@
 #include <cstdio>
 #include <cstring>
 #include <queue>
+#include <set>
 #include <cstdlib>
 #include <ctime>
 #include <cmath>
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
 #include "deque.h"
+#include "algorithm.h"
 #include "exceptions.h"
+#include "class-bint.h"
+#include "class-fixed-bint.h"
+#include "mapped-deque.h"
+#include "sorted-deque.h"
+#include "stable-deque.h"
 
 
 /***************************/
@@ -311,6 +324,690 @@ void test7(){
     }
     puts("Accept");
 }
+void test8(){
+    printf("test8: snapshot & copy-on-write      ");
+    // snapshot outlives the deque it was taken from
+    sjtu::deque<T> *writer = new sjtu::deque<T>;
+    for(int i = 0; i < N; i++) writer->push_back(T(i));
+    sjtu::deque<T> snap = writer->snapshot();
+    delete writer;
+    if(snap.size() != (size_t)N){puts("Wrong Answer");return;}
+    int cnt = 0;
+    for(_it_q = snap.cbegin(); _it_q != snap.cend(); ++_it_q, ++cnt)
+        if(_it_q -> num() != cnt){puts("Wrong Answer");return;}
+    snap.push_front(T(-1));
+    snap.pop_back();
+    if(snap.front().num() != -1 || snap.back().num() != N - 2){puts("Wrong Answer");return;}
+
+    // writes through a shared block clone it, the other side keeps the old contents
+    sjtu::deque<T> a;
+    for(int i = 0; i < N; i++) a.push_back(T(i));
+    sjtu::deque<T> b = a.snapshot();
+    a[N / 2].change(-1);
+    b.begin() -> change(-2);
+    *(b.end() - 1) = T(-3);
+    a.insert(a.begin() + N / 3, T(-4));
+    b.erase(b.begin() + N / 4);
+    const sjtu::deque<T> &ca = a, &cb = b;
+    if(ca.size() != (size_t)N + 1 || cb.size() != (size_t)N - 1){puts("Wrong Answer");return;}
+    if(ca[0].num() != 0 || ca[N / 3].num() != -4 || ca[N / 2 + 1].num() != -1 || ca[N].num() != N - 1)
+        {puts("Wrong Answer");return;}
+    if(cb[0].num() != -2 || cb[N / 4].num() != N / 4 + 1 || cb[N / 2 - 1].num() != N / 2 || cb[N - 2].num() != -3)
+        {puts("Wrong Answer");return;}
+
+    sjtu::deque<std::string> s;
+    for(int i = 0; i < 1000; i++) s.push_back(std::to_string(i));
+    sjtu::deque<std::string> t = s.snapshot();
+    s[500] += "x";
+    s.pop_front();
+    if(t[500] != "500" || s[499] != "500x" || t.front() != "0" || s.front() != "1"){puts("Wrong Answer");return;}
+
+    // snapshot read and destroyed on another thread while the writer keeps going
+    for(int round = 0; round < 8; round++){
+        long long expected = 0, seen = 0;
+        for(_it_q = ca.cbegin(); _it_q != ca.cend(); ++_it_q) expected += _it_q -> num();
+        sjtu::deque<T> *reader = new sjtu::deque<T>(a.snapshot());
+        std::thread worker([reader, &seen]{
+            for(sjtu::deque<T>::const_iterator it = reader->cbegin(); it != reader->cend(); ++it) seen += it -> num();
+            delete reader;
+        });
+        for(int i = 0; i < 1000; i++){
+            a[rand() % a.size()].change(rand());
+            a.push_back(T(i));
+            a.pop_front();
+        }
+        worker.join();
+        if(seen != expected){puts("Wrong Answer");return;}
+    }
+    puts("Accept");
+}
+bool check_range(sjtu::deque<long long, sjtu::sum_monoid<long long> > &s,
+                 sjtu::deque<int, sjtu::min_monoid<int> > &m, const std::deque<long long> &ref){
+    if(s.size() != ref.size() || m.size() != ref.size()) return 0;
+    for(int t = 0; t < 5; t++){
+        size_t l = rand() % (ref.size() + 1), r = rand() % (ref.size() + 1);
+        if(t == 0) l = 0, r = ref.size();
+        if(l > r) std::swap(l, r);
+        long long sum = 0;
+        int mn = std::numeric_limits<int>::max();
+        for(size_t i = l; i < r; i++) sum += ref[i], mn = std::min(mn, (int)ref[i]);
+        if(s.range_query(l, r) != sum || m.range_query(l, r) != mn) return 0;
+    }
+    return 1;
+}
+void test9(){
+    printf("test9: range_query                   ");
+    sjtu::deque<long long, sjtu::sum_monoid<long long> > s;
+    sjtu::deque<int, sjtu::min_monoid<int> > m;
+    std::deque<long long> ref;
+    for(int i = 0; i < 20000; i++){
+        int op = rand() % 10;
+        int v = rand() % 1000 - 500;
+        size_t k = ref.empty() ? 0 : rand() % ref.size();
+        if(op <= 2) s.push_back(v), m.push_back(v), ref.push_back(v);
+        else if(op <= 4) s.push_front(v), m.push_front(v), ref.push_front(v);
+        else if(ref.empty()) continue;
+        else if(op == 5) s.pop_back(), m.pop_back(), ref.pop_back();
+        else if(op == 6) s.pop_front(), m.pop_front(), ref.pop_front();
+        else if(op == 7) s.insert(s.begin() + k, v), m.insert(m.begin() + k, v), ref.insert(ref.begin() + k, v);
+        else if(op == 8) s.erase(s.begin() + k), m.erase(m.begin() + k), ref.erase(ref.begin() + k);
+        else s.set(k, v), m.set(k, v), ref[k] = v;
+        if(i % 100 == 0 && !check_range(s, m, ref)) {puts("Wrong Answer");return;}
+    }
+    // writes through references and iterators, finished before the next query
+    for(int round = 0; round < 20; round++){
+        for(int i = 0; i < 50; i++){
+            size_t k = rand() % ref.size();
+            s[k] += 3;
+            *(m.begin() + k) += 3;
+            ref[k] += 3;
+        }
+        if(!check_range(s, m, ref)) {puts("Wrong Answer");return;}
+    }
+    while(!ref.empty()) s.pop_front(), m.pop_back(), ref.pop_front();
+    if(s.range_query(0, 0) != 0 || m.range_query(0, 0) != std::numeric_limits<int>::max()) {puts("Wrong Answer");return;}
+    puts("Accept");
+}
+template<class V>
+std::string to_str(const V &x){
+    std::ostringstream os;
+    os << x;
+    return os.str();
+}
+std::string random_digits(int n){
+    std::string s(n, '0');
+    for(int i = 0; i < n; i++) s[i] = '0' + rand() % 10;
+    if(s[0] == '0') s[0] = '1' + rand() % 9;
+    return (rand() % 2 ? "-" : "") + s;
+}
+// (10^n - 1)^2 = 9..98 0..01
+std::string nines_squared(int n){
+    return n == 1 ? "81" : std::string(n - 1, '9') + "8" + std::string(n - 1, '0') + "1";
+}
+bool check_small(long long a, long long b){
+    Util::Bint x(a), y(b);
+    if(to_str(x + y) != std::to_string(a + b) || to_str(x - y) != std::to_string(a - b) ||
+       to_str(x * y) != std::to_string(a * b)) return 0;
+    if((x < y) != (a < b) || (x == y) != (a == b) || (x >= y) != (a >= b)) return 0;
+    if(b != 0 && (to_str(x / y) != std::to_string(a / b) || to_str(x % y) != std::to_string(a % b))) return 0;
+    return 1;
+}
+// 每种乘法区间对同一组操作数的结果都要与逐位乘法一致,并满足(10^n-1)^2的闭式
+bool check_multiply(const std::vector<std::string> &operands, const std::vector<std::string> &expected){
+    for(size_t i = 0; i + 1 < operands.size(); i += 2){
+        if(to_str(Util::Bint(operands[i]) * Util::Bint(operands[i + 1])) != expected[i / 2]) return 0;
+    }
+    for(int n : {1, 9, 10, 100, 1000, 4000}){
+        Util::Bint x(std::string(n, '9'));
+        if(to_str(x * x) != nines_squared(n) || to_str(x * -x) != "-" + nines_squared(n)) return 0;
+    }
+    return 1;
+}
+void test10(){
+    printf("test10: Bint arithmetic              ");
+    Util::Bint::MultiplyThresholds saved = Util::Bint::multiplyThresholds;
+    size_t saved_arena = Util::Bint::arenaBytes;
+    for(int i = 0; i < 20000; i++){
+        long long a = rand() % 4000000001LL - 2000000000, b = rand() % 4000000001LL - 2000000000;
+        if(i % 7 == 0) b = rand() % 21 - 10;
+        if(i % 11 == 0) a = 0;
+        if(!check_small(a, b)) {puts("Wrong Answer");return;}
+    }
+    if(!check_small(std::numeric_limits<long long>::min() + 1, -1)) {puts("Wrong Answer");return;}
+    if(to_str(Util::Bint(std::numeric_limits<long long>::min())) != "-9223372036854775808") {puts("Wrong Answer");return;}
+
+    // 全是9的进位链,加法和减法分别打开和关闭向量内核
+    for(int simd = 0; simd < 2; simd++){
+        Util::Bint::simdKernels = simd;
+        for(int n : {1, 8, 9, 10, 144, 145, 1000}){
+            Util::Bint nines(std::string(n, '9')), power("1" + std::string(n, '0'));
+            if(to_str(nines + 1) != "1" + std::string(n, '0') || power - 1 != nines || power - nines != 1 ||
+               to_str(-nines - 1) != "-1" + std::string(n, '0') || nines - power != -1) {puts("Wrong Answer");return;}
+            if(!(nines < power) || !(-power < -nines) || nines == power || nines + 1 != power) {puts("Wrong Answer");return;}
+            Util::Bint acc = nines;
+            acc += nines;
+            acc -= power;
+            acc += 1;
+            if(acc != nines) {puts("Wrong Answer");return;}
+        }
+        for(int i = 0; i < 50; i++){
+            Util::Bint a(random_digits(150 + rand() % 200)), b(random_digits(150 + rand() % 200));
+            Util::Bint s = a + b;
+            if(s - b != a || s - a != b || (a < b) != (a - b < 0) || (a == b) != (a - b == 0)) {puts("Wrong Answer");return;}
+        }
+    }
+    Util::Bint::simdKernels = true;
+
+    // 逐位乘法的结果作为其余区间的参照
+    std::vector<std::string> operands, expected;
+    for(int i = 0; i < 6; i++){
+        operands.push_back(random_digits(1 + rand() % 3000));
+        operands.push_back(random_digits(1 + rand() % 3000));
+    }
+    operands.push_back("0");
+    operands.push_back(random_digits(500));
+    Util::Bint::multiplyThresholds = {1000000, 1000000, 1000000, 1000000};
+    for(size_t i = 0; i < operands.size(); i += 2) expected.push_back(to_str(Util::Bint(operands[i]) * Util::Bint(operands[i + 1])));
+    Util::Bint::MultiplyThresholds regions[] = {
+        {1000000, 1000000, 1000000, 1000000}, // schoolbook
+        {2, 1000000, 1000000, 1000000},       // Karatsuba
+        {2, 3, 1000000, 1000000},             // Toom-3
+        {2, 3, 4, 1000000},                   // NTT
+        {2, 3, 4, 4},                         // parallel NTT
+    };
+    for(int threads = 1; threads <= 4; threads *= 4){
+        Util::Bint::multiplyThreads = threads;
+        for(const Util::Bint::MultiplyThresholds &region : regions){
+            Util::Bint::multiplyThresholds = region;
+            if(!check_multiply(operands, expected)) {puts("Wrong Answer");return;}
+        }
+    }
+    Util::Bint::multiplyThreads = 1;
+    Util::Bint::multiplyThresholds = saved;
+
+    Util::Bint factorial = 1;
+    for(int i = 2; i <= 30; i++) factorial *= i;
+    if(to_str(factorial) != "265252859812191058636308480000000") {puts("Wrong Answer");return;}
+    if(to_str(pow(Util::Bint(2), 256)) != "115792089237316195423570985008687907853269984665640564039457584007913129639936")
+        {puts("Wrong Answer");return;}
+    if(to_str(pow(Util::Bint(-3), 3)) != "-27" || to_str(pow(Util::Bint(7), 0)) != "1") {puts("Wrong Answer");return;}
+
+    // 除法:q * b + r == a,|r| < |b|,余数与被除数同号;另有闭式(10^2n - 1) / (10^n - 1) = 10^n + 1
+    for(int arena = 0; arena < 2; arena++){
+        Util::Bint::arenaBytes = arena ? saved_arena : 0;
+        for(int i = 0; i < 200; i++){
+            Util::Bint a(random_digits(1 + rand() % 600)), b(random_digits(1 + rand() % 300)), q, r;
+            divmod(a, b, q, r);
+            if(q * b + r != a || abs(r) >= abs(b) || (r != 0 && (r < 0) != (a < 0))) {puts("Wrong Answer");return;}
+            if(a / b != q || a % b != r) {puts("Wrong Answer");return;}
+        }
+        for(int n : {1, 9, 10, 300}){
+            Util::Bint x(std::string(2 * n, '9')), y(std::string(n, '9'));
+            if(to_str(x / y) != "1" + std::string(n - 1, '0') + "1" || x % y != 0 || to_str(-x / y) != "-1" + std::string(n - 1, '0') + "1")
+                {puts("Wrong Answer");return;}
+        }
+    }
+    Util::Bint::arenaBytes = saved_arena;
+    Util::Bint::releaseArena();
+    try{
+        Util::Bint(1) / Util::Bint(0);
+        puts("Wrong Answer");return;
+    }catch(std::domain_error &){}
+
+    // powmod:结果在[0, |m|)内;费马小定理对10^9+7和2^127-1成立
+    for(int i = 0; i < 2000; i++){
+        long long b = rand() % 2001 - 1000, e = rand() % 100, m = rand() % 2000 - 1000;
+        if(m == 0) continue;
+        long long mod = m < 0 ? -m : m, r = 1 % mod, base = ((b % mod) + mod) % mod;
+        for(long long k = 0; k < e; k++) r = r * base % mod;
+        if(powmod(Util::Bint(b), Util::Bint(e), Util::Bint(m)) != r) {puts("Wrong Answer");return;}
+    }
+    Util::Bint mersenne = pow(Util::Bint(2), 127) - 1;
+    if(powmod(Util::Bint(3), mersenne - 1, mersenne) != 1 || powmod(Util::Bint(123456789), Util::Bint(1000000006), Util::Bint(-1000000007)) != 1)
+        {puts("Wrong Answer");return;}
+    try{
+        powmod(Util::Bint(2), Util::Bint(-1), Util::Bint(7));
+        puts("Wrong Answer");return;
+    }catch(std::domain_error &){}
+
+    // 流输入输出
+    std::istringstream is("00012 -000 -123456789012345678901234567890 7");
+    Util::Bint a, b, c, d;
+    is >> a >> b >> c >> d;
+    if(!is || to_str(a) != "12" || to_str(b) != "0" || to_str(c) != "-123456789012345678901234567890" || d != 7)
+        {puts("Wrong Answer");return;}
+    for(int i = 0; i < 100; i++){
+        std::string s = random_digits(1 + rand() % 300);
+        Util::Bint x;
+        std::istringstream in(s);
+        in >> x;
+        if(to_str(x) != s || to_str(Util::Bint(s)) != s) {puts("Wrong Answer");return;}
+    }
+    puts("Accept");
+}
+// 与Bint逐项比较,Bint的结果按2^Bits取模后应当相同
+template<size_t Bits>
+bool check_fixed(int digits){
+    typedef Util::FixedBint<Bits> F;
+    for(int i = 0; i < 2000; i++){
+        std::string sa = random_digits(1 + rand() % digits), sb = random_digits(1 + rand() % digits);
+        if(i % 10 == 0) sb = std::to_string(rand() % 7 - 3);
+        Util::Bint A(sa), B(sb);
+        F a(sa), b(B);
+        if(to_str(a) != sa || Util::Bint(b) != B || F(A) != a) return 0;
+        if(Util::Bint(a + b) != Util::Bint(F(A + B)) || Util::Bint(a - b) != Util::Bint(F(A - B)) ||
+           Util::Bint(a * b) != Util::Bint(F(A * B))) return 0;
+        if((a < b) != (A < B) || (a == b) != (A == B) || (a >= b) != (A >= B)) return 0;
+        if(B == 0) continue;
+        if(Util::Bint(a / b) != A / B || Util::Bint(a % b) != A % B) return 0;
+        int e = rand() % 1000;
+        if(Util::Bint(powmod(a, F(e), b)) != powmod(A, Util::Bint(e), B)) return 0;
+    }
+    return 1;
+}
+constexpr Util::FixedBint<128> fixed_factorial(int n){
+    Util::FixedBint<128> result = 1;
+    for(int i = 2; i <= n; i++) result *= i;
+    return result;
+}
+static_assert(fixed_factorial(30) / fixed_factorial(28) == 870 && fixed_factorial(25) % 1000000007 == 440732388,
+              "FixedBint must be usable in constant expressions");
+static_assert(Util::FixedBint<64>(-7) / 2 == -3 && Util::FixedBint<64>(-7) % 2 == -1 && Util::FixedBint<256>(7) % -2 == 1,
+              "FixedBint division truncates toward zero");
+void test11(){
+    printf("test11: FixedBint                    ");
+    typedef Util::FixedBint<64> F64;
+    typedef Util::FixedBint<128> F128;
+    typedef Util::FixedBint<256> F256;
+    if(!check_fixed<64>(18) || !check_fixed<128>(38) || !check_fixed<256>(76)) {puts("Wrong Answer");return;}
+
+    // 和内置整数一样按2^Bits回绕
+    const long long llmax = std::numeric_limits<long long>::max(), llmin = std::numeric_limits<long long>::min();
+    if(F64(llmax) + 1 != F64(llmin) || F64(llmin) - 1 != F64(llmax) || to_str(F64(llmin)) != "-9223372036854775808")
+        {puts("Wrong Answer");return;}
+    F128 max128 = F128(Util::Bint("170141183460469231731687303715884105727"));
+    if(to_str(max128 + 1) != "-170141183460469231731687303715884105728" || max128 * 2 != -2 || -(max128 + 1) != max128 + 1)
+        {puts("Wrong Answer");return;}
+    F256 max256 = F256(pow(Util::Bint(2), 255) - 1);
+    if(to_str(max256) != "57896044618658097711785492504343953926634992332820282019728792003956564819967" ||
+       max256 + 1 >= 0 || max256 + max256 + 2 != 0) {puts("Wrong Answer");return;}
+    if(F64(Util::Bint("18446744073709551616")) != 0 || F64(Util::Bint("18446744073709551615")) != -1 ||
+       F64(Util::Bint("-18446744073709551617")) != -1) {puts("Wrong Answer");return;}
+
+    // MIN / -1回绕为MIN,余数为0
+    if(F64(llmin) / -1 != F64(llmin) || F64(llmin) % -1 != 0 || (max128 + 1) / -1 != max128 + 1 || (max256 + 1) % -1 != 0)
+        {puts("Wrong Answer");return;}
+    if(F128(-7) / 2 != -3 || F128(-7) % 2 != -1 || F128(7) / -2 != -3 || F128(7) % -2 != 1 || F128(-7) % -2 != -1)
+        {puts("Wrong Answer");return;}
+    try{
+        F256(1) / F256(0);
+        puts("Wrong Answer");return;
+    }catch(std::domain_error &){}
+
+    // 模数为负时按|m|取模,结果非负
+    if(powmod(F64(3), F64(1000000006), F64(-1000000007)) != 1 || powmod(F128(-2), F128(3), F128(-5)) != 2 ||
+       powmod(F256(-2), F256(0), F256(-1)) != 0) {puts("Wrong Answer");return;}
+    try{
+        powmod(F64(2), F64(-1), F64(7));
+        puts("Wrong Answer");return;
+    }catch(std::domain_error &){}
+
+    // 位宽之间符号扩展或截断
+    if(F256(F64(-5)) != -5 || F64(F256(max256)) != -1 || F128(F64(llmin)) != llmin ||
+       F64(F128(Util::Bint("18446744073709551623"))) != 7) {puts("Wrong Answer");return;}
+
+    // from_chars和流输入
+    const char text[] = "-123456789012345678901234567890x";
+    F128 parsed;
+    const char *end = parsed.from_chars(text, text + sizeof(text) - 1);
+    if(*end != 'x' || to_str(parsed) != "-123456789012345678901234567890" || parsed.from_chars(end, end + 1) != end ||
+       parsed.chars_size() != 31) {puts("Wrong Answer");return;}
+    std::istringstream is("  -42\n0017 abc");
+    F256 x, y, z = 5;
+    is >> x >> y;
+    if(!is || x != -42 || y != 17) {puts("Wrong Answer");return;}
+    is >> z;
+    if(!is.fail() || z != 5) {puts("Wrong Answer");return;}
+    puts("Accept");
+}
+bool write_file(const char *path, const std::string &bytes){
+    FILE *file = fopen(path, "wb");
+    if(file == nullptr) return 0;
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && ok;
+}
+std::string read_file(const char *path){
+    std::string bytes;
+    FILE *file = fopen(path, "rb");
+    if(file == nullptr) return bytes;
+    char buffer[4096];
+    size_t n;
+    while((n = fread(buffer, 1, sizeof(buffer), file)) > 0) bytes.append(buffer, n);
+    fclose(file);
+    return bytes;
+}
+// 损坏的文件:load必须抛出异常且保持原内容,mapped_deque必须拒绝打开
+bool rejects(const char *path, const std::string &bytes){
+    if(!write_file(path, bytes)) return 0;
+    sjtu::deque<long long> target;
+    for(int i = 0; i < 300; i++) target.push_back(-i);
+    bool thrown = 0, mapped_thrown = 0;
+    try{ target.load(path); }catch(sjtu::runtime_error &){ thrown = 1; }
+    try{ sjtu::mapped_deque<long long> mapped(path); }catch(sjtu::runtime_error &){ mapped_thrown = 1; }
+    if(!thrown || !mapped_thrown || target.size() != 300) return 0;
+    for(int i = 0; i < 300; i++) if(target[i] != -i) return 0;
+    return 1;
+}
+void test12(){
+    printf("test12: save & load & mapped_deque   ");
+    const char *path = "deque-test-snapshot.bin", *bad = "deque-test-corrupt.bin";
+    sjtu::deque<long long> q;
+    std::deque<long long> ref;
+    for(int i = 0; i < 100000; i++){
+        long long v = (long long)rand() * rand();
+        if(i % 3 == 0) q.push_front(v), ref.push_front(v);
+        else q.push_back(v), ref.push_back(v);
+        if(i % 5 == 0) q.pop_back(), ref.pop_back();
+    }
+    q.save(path);
+    sjtu::deque<long long> loaded;
+    loaded.push_back(42);
+    loaded.load(path);
+    if(loaded.size() != ref.size()) {puts("Wrong Answer");return;}
+    {
+        sjtu::mapped_deque<long long> mapped(path);
+        if(mapped.size() != ref.size()) {puts("Wrong Answer");return;}
+        for(size_t i = 0; i < ref.size(); i++)
+            if(loaded[i] != ref[i] || mapped[i] != ref[i]) {puts("Wrong Answer");return;}
+    }
+    loaded.push_front(1);
+    loaded.insert(loaded.begin() + 777, 2);
+    if(loaded.front() != 1 || loaded[777] != 2 || loaded[778] != ref[776]) {puts("Wrong Answer");return;}
+
+    sjtu::deque<long long> empty;
+    empty.save(path);
+    loaded.load(path);
+    if(!loaded.empty()) {puts("Wrong Answer");return;}
+    {
+        sjtu::mapped_deque<long long> mapped(path);
+        if(!mapped.empty()) {puts("Wrong Answer");return;}
+    }
+
+    q.save(path);
+    std::string bytes = read_file(path);
+    sjtu::snapshot_header header;
+    memcpy(&header, bytes.data(), sizeof(header));
+    std::string corrupt = bytes.substr(0, bytes.size() - 1);
+    if(!rejects(bad, corrupt) || !rejects(bad, bytes.substr(0, sizeof(header) / 2))) {puts("Wrong Answer");return;}
+    corrupt = bytes;
+    corrupt[0] = 'X';
+    if(!rejects(bad, corrupt)) {puts("Wrong Answer");return;}
+    sjtu::snapshot_header broken = header;
+    broken.total_size = header.total_size + 1;
+    corrupt = bytes;
+    memcpy(&corrupt[0], &broken, sizeof(broken));
+    if(!rejects(bad, corrupt)) {puts("Wrong Answer");return;}
+    broken = header;
+    broken.block_count = (uint64_t)1 << 61;
+    corrupt = bytes;
+    memcpy(&corrupt[0], &broken, sizeof(broken));
+    if(!rejects(bad, corrupt)) {puts("Wrong Answer");return;}
+    broken = header;
+    broken.element_size = sizeof(int);
+    corrupt = bytes;
+    memcpy(&corrupt[0], &broken, sizeof(broken));
+    if(!rejects(bad, corrupt)) {puts("Wrong Answer");return;}
+    std::remove(path);
+    std::remove(bad);
+    puts("Accept");
+}
+void test13(){
+    printf("test13: sorted_deque                 ");
+    sjtu::sorted_deque<int> s;
+    const sjtu::sorted_deque<int> &cs = s;
+    std::multiset<int> ref;
+    for(int i = 0; i < 30000; i++){
+        int op = rand() % 10, v = rand() % 2000;
+        if(op <= 4){
+            if(*s.insert_sorted(v) != v) {puts("Wrong Answer");return;}
+            ref.insert(v);
+        }else if(op <= 6){
+            std::multiset<int>::iterator it = ref.find(v);
+            if(s.erase_value(v) != (it != ref.end())) {puts("Wrong Answer");return;}
+            if(it != ref.end()) ref.erase(it);
+        }else if(op == 7 && !ref.empty()){
+            if(cs.front() != *ref.begin()) {puts("Wrong Answer");return;}
+            s.pop_front();
+            ref.erase(ref.begin());
+        }else if(op == 8 && !ref.empty()){
+            if(cs.back() != *ref.rbegin()) {puts("Wrong Answer");return;}
+            s.pop_back();
+            ref.erase(--ref.end());
+        }else{
+            int lower = (int)std::distance(ref.begin(), ref.lower_bound(v));
+            int upper = (int)std::distance(ref.begin(), ref.upper_bound(v));
+            if(cs.lower_bound(v) - cs.begin() != lower || cs.upper_bound(v) - cs.begin() != upper ||
+               cs.count(v) != ref.count(v) || (cs.find(v) == cs.end()) != (ref.find(v) == ref.end()))
+                {puts("Wrong Answer");return;}
+        }
+        if(cs.size() != ref.size()) {puts("Wrong Answer");return;}
+    }
+    size_t k = 0;
+    for(std::multiset<int>::iterator it = ref.begin(); it != ref.end(); ++it, ++k)
+        if(cs[k] != *it) {puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test14(){
+    printf("test14: stable_deque handles         ");
+    sjtu::stable_deque<std::string> s;
+    std::vector<sjtu::stable_deque<std::string>::handle> handles;
+    std::vector<const std::string *> addresses;
+    for(int i = 0; i < 2000; i++){
+        handles.push_back(i % 2 ? s.push_back(std::to_string(i)) : s.push_front(std::to_string(i)));
+        addresses.push_back(&s[handles.back()]);
+    }
+    // 重排之后地址和句柄都不变
+    for(int i = 0; i < 2000; i++)
+        if(&s[handles[i]] != addresses[i] || s[handles[i]] != std::to_string(i)) {puts("Wrong Answer");return;}
+    // 位置:push_front的元素逆序排在前面,push_back的元素顺序排在后面
+    for(int i = 0; i < 2000; i++){
+        size_t pos = i % 2 ? 1000 + i / 2 : 999 - i / 2;
+        if(s.index_of(handles[i]) != pos || s.handle_at(pos) != handles[i]) {puts("Wrong Answer");return;}
+    }
+    // 从头部弹出之后,剩下元素的位置整体前移
+    for(int i = 0; i < 100; i++) s.pop_front();
+    for(int i = 0; i < 2000; i++){
+        long long pos = (i % 2 ? 1000 + i / 2 : 999 - i / 2) - 100;
+        if(pos < 0){
+            if(s.contains(handles[i])) {puts("Wrong Answer");return;}
+            try{
+                s.at(handles[i]);
+                puts("Wrong Answer");return;
+            }catch(sjtu::invalid_iterator &){}
+        }else if(s.index_of(handles[i]) != (size_t)pos) {puts("Wrong Answer");return;}
+    }
+    // 从中间删除,被删除的句柄失效,其余元素顺序不变
+    std::deque<std::string> ref;
+    for(size_t i = 0; i < s.size(); i++) ref.push_back(s.at(i));
+    for(int i = 1; i < 2000; i += 3){
+        if(!s.contains(handles[i])) continue;
+        size_t pos = s.index_of(handles[i]);
+        s.erase(handles[i]);
+        ref.erase(ref.begin() + pos);
+        if(s.contains(handles[i])) {puts("Wrong Answer");return;}
+        try{
+            s.erase(handles[i]);
+            puts("Wrong Answer");return;
+        }catch(sjtu::invalid_iterator &){}
+    }
+    if(s.size() != ref.size()) {puts("Wrong Answer");return;}
+    for(size_t i = 0; i < ref.size(); i++) if(s.at(i) != ref[i]) {puts("Wrong Answer");return;}
+    // 复用的下标带着新的代数,旧句柄不会指向新元素
+    sjtu::stable_deque<std::string>::handle fresh = s.push_back("fresh");
+    for(int i = 1; i < 2000; i += 3)
+        if(handles[i].index == fresh.index && (s.contains(handles[i]) || handles[i] == fresh)) {puts("Wrong Answer");return;}
+    if(s.back() != "fresh" || s.index_of(fresh) != s.size() - 1) {puts("Wrong Answer");return;}
+    s.clear();
+    if(!s.empty() || s.contains(fresh) || s.contains(handles[0])) {puts("Wrong Answer");return;}
+    puts("Accept");
+}
+// 与std::deque逐项比较find/count,元素类型不走向量内核时走逐个比较的分支
+template<class V>
+bool check_search(sjtu::deque<V> &q, const std::deque<V> &ref, const std::vector<V> &probes){
+    if(q.size() != ref.size()) return 0;
+    const sjtu::deque<V> &cq = q;
+    for(size_t i = 0; i < probes.size(); i++){
+        typename std::deque<V>::const_iterator expect = std::find(ref.begin(), ref.end(), probes[i]);
+        typename sjtu::deque<V>::const_iterator got = sjtu::find(cq, probes[i]);
+        if(expect == ref.end() ? got != cq.cend() : got == cq.cend() || got - cq.cbegin() != expect - ref.begin() || *got != probes[i]) return 0;
+        typename sjtu::deque<V>::iterator it = sjtu::find(q, probes[i]);
+        if((it == q.end()) != (expect == ref.end()) || (it != q.end() && it - q.begin() != expect - ref.begin())) return 0;
+        if(sjtu::count(cq, probes[i]) != (size_t)std::count(ref.begin(), ref.end(), probes[i])) return 0;
+    }
+    return 1;
+}
+// sum/min_element/max_element与逐个累加的结果比较,最值要定位到第一次出现的位置
+template<class V>
+bool check_reduce(const sjtu::deque<V> &, const std::deque<V> &, std::false_type){return 1;}
+template<class V>
+bool check_reduce(const sjtu::deque<V> &q, const std::deque<V> &ref, std::true_type){
+    typename sjtu::sum_type<V>::type total = 0;
+    for(size_t i = 0; i < ref.size(); i++) total += ref[i];
+    if(sjtu::sum(q) != total) return 0;
+    if(ref.empty()) return sjtu::min_element(q) == q.cend() && sjtu::max_element(q) == q.cend();
+    return sjtu::min_element(q) - q.cbegin() == std::min_element(ref.begin(), ref.end()) - ref.begin() &&
+           sjtu::max_element(q) - q.cbegin() == std::max_element(ref.begin(), ref.end()) - ref.begin();
+}
+template<class V>
+bool check_algorithm_stage(sjtu::deque<V> &q, const std::deque<V> &ref, const std::vector<V> &probes){
+    return check_search(q, ref, probes) && check_reduce(q, ref, std::integral_constant<bool, sjtu::simd_arithmetic<V>::value>());
+}
+// 两端交替插入让块内的循环数组绕回,中间的插入删除触发分裂与合并,每个阶段都与参照比较
+template<class V, class Make>
+bool check_algorithm(Make make){
+    sjtu::deque<V> q;
+    std::deque<V> ref;
+    std::vector<V> probes;
+    for(int i = -3; i < 40; i++) probes.push_back(make(i * 37));
+    for(int round = 0; round < 4; round++){
+        for(int i = 0; i < 6000; i++){
+            V v = make(rand() % 2001 - 1000);
+            if(rand() % 2) q.push_back(v), ref.push_back(v);
+            else q.push_front(v), ref.push_front(v);
+        }
+        for(int i = 0; i < 1500; i++){
+            size_t pos = rand() % (ref.size() + 1);
+            V v = make(rand() % 2001 - 1000);
+            q.insert(q.begin() + pos, v);
+            ref.insert(ref.begin() + pos, v);
+        }
+        if(!check_algorithm_stage(q, ref, probes)) return 0;
+        while(ref.size() > 300u * (3 - round) + 1){
+            size_t pos = rand() % ref.size();
+            q.erase(q.begin() + pos);
+            ref.erase(ref.begin() + pos);
+        }
+        if(!check_algorithm_stage(q, ref, probes)) return 0;
+    }
+    // 值只出现在最后一个元素,以及清空之后
+    V last = make(5000);
+    q.push_back(last), ref.push_back(last);
+    if(sjtu::find(q, last) - q.begin() != (int)ref.size() - 1 || sjtu::count(q, last) != 1) return 0;
+    q.clear(), ref.clear();
+    if(!check_algorithm_stage(q, ref, probes)) return 0;
+    return q.stats().splits > 0 && q.stats().merges > 0;
+}
+int make_int(int x){return x;}
+double make_double(int x){return x * 0.5;}
+short make_short(int x){return (short)x;}
+std::string make_string(int x){return std::to_string(x);}
+void test15(){
+    printf("test15: find & count & sum & min/max ");
+    if(!check_algorithm<int>(make_int) || !check_algorithm<double>(make_double) ||
+       !check_algorithm<long long>([](int x){return (long long)x * (1LL << 33);}) ||
+       !check_algorithm<short>(make_short) || !check_algorithm<std::string>(make_string)) {puts("Wrong Answer");return;}
+    // 快照共享的块上的查找不复制数组
+    sjtu::deque<int> a;
+    for(int i = 0; i < 10000; i++) a.push_back(i % 100);
+    sjtu::deque<int> b = a.snapshot();
+    if(sjtu::count(b, 7) != 100 || sjtu::find(b, 99) - b.begin() != 99 || sjtu::sum(b) != 495000 || a.stats().clones + b.stats().clones != 0) {puts("Wrong Answer");return;}
+    puts("Accept");
+}
+// 中间插入删除时整块搬移元素,元素放在堆上的类型只搬移指针
+template<class V, class Make>
+bool check_relocate(Make make){
+    sjtu::deque<V> q;
+    std::deque<V> ref;
+    for(int i = 0; i < 20000; i++){
+        size_t pos = rand() % (ref.size() + 1);
+        if(i % 5 == 4 && !ref.empty()){
+            pos = rand() % ref.size();
+            q.erase(q.begin() + pos);
+            ref.erase(ref.begin() + pos);
+        }else{
+            V v = make(i);
+            typename sjtu::deque<V>::iterator it = q.insert(q.begin() + pos, v);
+            ref.insert(ref.begin() + pos, v);
+            if(*it != v) return 0;
+        }
+    }
+    while(ref.size() > 100){
+        size_t pos = rand() % ref.size();
+        typename sjtu::deque<V>::iterator it = q.erase(q.begin() + pos);
+        ref.erase(ref.begin() + pos);
+        if(pos < ref.size() && *it != ref[pos]) return 0;
+    }
+    if(q.size() != ref.size()) return 0;
+    for(size_t i = 0; i < ref.size(); i++) if(q[i] != ref[i]) return 0;
+    return q.stats().splits > 0 && q.stats().merges > 0;
+}
+void test16(){
+    printf("test16: relocation & reserve & clear ");
+    if(!check_relocate<int>(make_int) || !check_relocate<std::string>(make_string)) {puts("Wrong Answer");return;}
+    sjtu::deque<int> q;
+    std::deque<int> ref;
+    for(int i = 0; i < 1000; i++) q.push_back(i), ref.push_back(i);
+    // 预留之后的push不再分配,规模达到预期后size_hint失效
+    q.reserve_back(100000);
+    if(q.capacity() < 101000 || q.size_hint != 101000 || q.stats().spare_blocks == 0) {puts("Wrong Answer");return;}
+    size_t allocations = q.stats().allocations;
+    for(int i = 0; i < 99999; i++) q.push_back(i), ref.push_back(i);
+    if(q.stats().allocations != allocations || q.size_hint != 101000) {puts("Wrong Answer");return;}
+    q.push_back(-1), ref.push_back(-1);
+    if(q.size_hint != 0) {puts("Wrong Answer");return;}
+    q.reserve_front(50000);
+    allocations = q.stats().allocations;
+    for(int i = 0; i < 50000; i++) q.push_front(i), ref.push_front(i);
+    if(q.stats().allocations != allocations || q.size_hint != 0) {puts("Wrong Answer");return;}
+    // 大量弹出后收缩,内容不变,预留块全部释放
+    while(ref.size() > 3000){
+        if(rand() % 2) q.pop_front(), ref.pop_front();
+        else q.pop_back(), ref.pop_back();
+    }
+    q.reserve_back(10000);
+    size_t before = q.capacity();
+    q.shrink_to_fit();
+    if(q.capacity() >= before || q.capacity() < q.size() || q.stats().spare_blocks != 0 || q.size_hint != 0) {puts("Wrong Answer");return;}
+    for(size_t i = 0; i < ref.size(); i++) if(q[i] != ref[i]) {puts("Wrong Answer");return;}
+    // clear()留下一个空块,再次插入不必分配;clear(false)归还全部内存
+    q.clear();
+    if(!q.empty() || q.capacity() == 0 || q.stats().spare_blocks != 1 || q.stats().block_count != 0) {puts("Wrong Answer");return;}
+    allocations = q.stats().allocations;
+    for(int i = 0; i < 10; i++) q.push_front(i);
+    if(q.stats().allocations != allocations || q.front() != 9 || q.back() != 0) {puts("Wrong Answer");return;}
+    q.shrink_to_fit();
+    q.clear(false);
+    if(!q.empty() || q.capacity() != 0 || q.stats().total_bytes != 0) {puts("Wrong Answer");return;}
+    sjtu::deque<std::string> s;
+    for(int i = 0; i < 5000; i++) s.push_back(make_string(i));
+    s.clear();
+    if(!s.empty() || s.capacity() == 0 || s.stats().element_bytes != 0) {puts("Wrong Answer");return;}
+    s.push_back("x");
+    if(s.size() != 1 || s.front() != "x") {puts("Wrong Answer");return;}
+    s.clear(false);
+    if(s.capacity() != 0) {puts("Wrong Answer");return;}
+    puts("Accept");
+}
 int main(){
     srand(time(NULL));
     puts("test start:");
@@ -321,4 +1018,13 @@ int main(){
     test5();//erase & insert
     test6();//clear & copy & assignment
     test7();//complexity
+    test8();//snapshot & copy-on-write
+    test9();//range_query
+    test10();//Bint arithmetic
+    test11();//FixedBint
+    test12();//save & load & mapped_deque
+    test13();//sorted_deque
+    test14();//stable_deque handles
+    test15();//find & count & sum & min/max
+    test16();//relocation & reserve & clear
 }
\ No newline at end of file
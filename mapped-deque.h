@@ -0,0 +1,118 @@
+#ifndef SJTU_MAPPED_DEQUE_HPP
+#define SJTU_MAPPED_DEQUE_HPP
+
+#include "deque.h"
+#include "exceptions.h"
+
+#include <cstddef>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sjtu {
+    /**
+     * 直接从deque::save()写出的文件上提供只读访问.
+     * 文件整体mmap进来,元素在data_offset之后连续存放,at()就是一次指针偏移,
+     * 打开时只校验文件头,不解析也不拷贝元素.
+     */
+    template<class T>
+    class mapped_deque {
+        void *base;
+        size_t length;
+        const T *elements;
+        size_t total_size;
+
+    public:
+        typedef T value_type;
+        typedef const T *const_iterator;
+
+        /**
+         * map a file written by deque<T>::save().
+         * throw runtime_error if it cannot be mapped or does not match T.
+         */
+        explicit mapped_deque(const std::string &path): base(nullptr), length(0), elements(nullptr), total_size(0) {
+            static_assert(!deque_slot<T>::owns_heap, "mapped_deque requires a trivially copyable element type");
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw runtime_error();
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(snapshot_header)) {
+                close(fd);
+                throw runtime_error();
+            }
+            length = static_cast<size_t>(st.st_size);
+            base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (base == MAP_FAILED) {
+                throw runtime_error();
+            }
+            const snapshot_header *header = static_cast<const snapshot_header *>(base);
+            // 先确认data_offset在文件内,再用剩余长度约束元素数,避免乘法溢出
+            if (!header->valid(sizeof(T)) || header->data_offset > length ||
+                header->total_size > (length - header->data_offset) / sizeof(T)) {
+                munmap(base, length);
+                throw runtime_error();
+            }
+            elements = reinterpret_cast<const T *>(static_cast<const char *>(base) + header->data_offset);
+            total_size = header->total_size;
+        }
+
+        mapped_deque(const mapped_deque &) = delete;
+
+        mapped_deque &operator=(const mapped_deque &) = delete;
+
+        ~mapped_deque() {
+            munmap(base, length);
+        }
+
+        /**
+         * access a specified element with bound checking.
+         * throw index_out_of_bound if out of bound.
+         */
+        const T &at(const size_t &pos) const {
+            if (pos >= total_size) {
+                throw index_out_of_bound();
+            }
+            return elements[pos];
+        }
+
+        const T &operator[](const size_t &pos) const {
+            return elements[pos];
+        }
+
+        const T &front() const {
+            if (empty()) {
+                throw container_is_empty();
+            }
+            return elements[0];
+        }
+
+        const T &back() const {
+            if (empty()) {
+                throw container_is_empty();
+            }
+            return elements[total_size - 1];
+        }
+
+        const_iterator begin() const {
+            return elements;
+        }
+
+        const_iterator end() const {
+            return elements + total_size;
+        }
+
+        bool empty() const {
+            return total_size == 0;
+        }
+
+        size_t size() const {
+            return total_size;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef SJTU_MONOTONIC_DEQUE_HPP
+#define SJTU_MONOTONIC_DEQUE_HPP
+
+#include "deque.h"
+#include "exceptions.h"
+
+#include <cstddef>
+#include <functional>
+
+namespace sjtu {
+    /**
+     * 滑动窗口最小值/最大值.窗口本身不保存,只记录进出窗口的序号;
+     * 两个deque分别保存按Compare单调递增/递减的候选元素及其序号,
+     * 新元素从尾部挤掉不可能再成为最值的候选,窗口左端越过候选时从头部弹出,
+     * 每个元素最多进出候选各一次,均摊O(1).
+     */
+    template<class T, class Compare = std::less<T> >
+    class monotonic_deque {
+        struct entry {
+            size_t seq;
+            T value;
+        };
+
+        deque<entry> mins; // front是窗口最小值
+        deque<entry> maxs; // front是窗口最大值
+        size_t pushed; // 进入过窗口的元素个数,也是下一个元素的序号
+        size_t popped; // 离开过窗口的元素个数,窗口为[popped, pushed)
+        Compare comp;
+
+        // 丢掉已经离开窗口的候选
+        void expire() {
+            while (!mins.empty() && mins.front().seq < popped) {
+                mins.pop_front();
+            }
+            while (!maxs.empty() && maxs.front().seq < popped) {
+                maxs.pop_front();
+            }
+        }
+
+    public:
+        typedef T value_type;
+
+        explicit monotonic_deque(const Compare &comp = Compare()): pushed(0), popped(0), comp(comp) {
+        }
+
+        /**
+         * add value at the right end of the window.
+         */
+        void push_back(const T &value) {
+            // 相等的旧元素会比新元素先离开窗口,同样可以丢掉;
+            // 最后一个候选就地覆盖,避免deque变空时释放块、下一次再分配
+            while (mins.size() > 1 && !comp(mins.back().value, value)) {
+                mins.pop_back();
+            }
+            if (!mins.empty() && !comp(mins.back().value, value)) {
+                mins[mins.size() - 1] = entry{pushed, value};
+            } else {
+                mins.push_back(entry{pushed, value});
+            }
+            while (maxs.size() > 1 && !comp(value, maxs.back().value)) {
+                maxs.pop_back();
+            }
+            if (!maxs.empty() && !comp(value, maxs.back().value)) {
+                maxs[maxs.size() - 1] = entry{pushed, value};
+            } else {
+                maxs.push_back(entry{pushed, value});
+            }
+            pushed++;
+        }
+
+        template<class InputIt>
+        void push_back(InputIt first, InputIt last) {
+            for (; first != last; ++first) {
+                push_back(*first);
+            }
+        }
+
+        /**
+         * remove the leftmost element of the window.
+         * throw container_is_empty if the window is empty.
+         */
+        void pop_front() {
+            pop_front(1);
+        }
+
+        /**
+         * remove the count leftmost elements of the window.
+         * throw container_is_empty if the window holds fewer than count elements.
+         */
+        void pop_front(size_t count) {
+            if (count > size()) {
+                throw container_is_empty();
+            }
+            popped += count;
+            expire();
+        }
+
+        /**
+         * slide the window over [first, last) without changing its size:
+         * every element pushed at the right drops one from the left.
+         * the extremes in between are not observable; use slide() for those.
+         */
+        template<class InputIt>
+        void advance(InputIt first, InputIt last) {
+            size_t count = 0;
+            for (; first != last; ++first, ++count) {
+                push_back(*first);
+            }
+            pop_front(count);
+        }
+
+        /**
+         * push every element of [first, last), keeping at most window elements,
+         * and call visit(min(), max()) after each one.
+         * throw runtime_error if window is 0.
+         */
+        template<class InputIt, class Visitor>
+        void slide(InputIt first, InputIt last, size_t window, Visitor visit) {
+            if (window == 0) {
+                throw runtime_error();
+            }
+            if (size() > window) {
+                pop_front(size() - window);
+            }
+            for (; first != last; ++first) {
+                push_back(*first);
+                if (pushed - popped > window) {
+                    popped++;
+                    expire();
+                }
+                visit(mins.front().value, maxs.front().value);
+            }
+        }
+
+        /**
+         * the smallest element of the window under Compare.
+         * throw container_is_empty if the window is empty.
+         */
+        const T &min() const {
+            if (empty()) {
+                throw container_is_empty();
+            }
+            return mins.front().value;
+        }
+
+        /**
+         * the largest element of the window under Compare.
+         * throw container_is_empty if the window is empty.
+         */
+        const T &max() const {
+            if (empty()) {
+                throw container_is_empty();
+            }
+            return maxs.front().value;
+        }
+
+        // 窗口中的元素个数,不是候选个数
+        size_t size() const {
+            return pushed - popped;
+        }
+
+        bool empty() const {
+            return pushed == popped;
+        }
+
+        void clear() {
+            mins.clear();
+            maxs.clear();
+            pushed = popped = 0;
+        }
+    };
+}
+
+#endif
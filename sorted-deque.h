@@ -0,0 +1,162 @@
+#ifndef SJTU_SORTED_DEQUE_HPP
+#define SJTU_SORTED_DEQUE_HPP
+
+#include "deque.h"
+#include "exceptions.h"
+
+#include <cstddef>
+#include <functional>
+
+namespace sjtu {
+    /**
+     * 在deque上维护有序序列(允许重复),可当作廉价的有序多重集合使用.
+     * 序列有序时每块的最小/最大键就是块首/块尾元素,
+     * 查找先按块尾跳过整块(O(块数)),再在块内二分(O(log 块长)),
+     * 插入和删除再加上deque本身O(sqrt n)的平移,总体O(sqrt n).
+     */
+    template<class T, class Compare = std::less<T> >
+    class sorted_deque {
+    public:
+        typedef T value_type;
+        typedef typename deque<T>::Block Block;
+        typedef typename deque<T>::iterator iterator;
+        typedef typename deque<T>::const_iterator const_iterator;
+
+    private:
+        typedef deque_slot<T> slot;
+
+        deque<T> data;
+        Compare comp;
+
+        // 定位第一个使pred(元素)为false的位置;pred在序列上必须先真后假.只读,不会复制共享的块
+        template<class Pred>
+        const_iterator partition_point(Pred pred) const {
+            size_t cur = 0;
+            for (Block *block = data.head_block; block != nullptr; block = block->next) {
+                if (block->size == 0 || pred(slot::ref(block->at(block->size - 1)))) {
+                    cur += block->size;
+                    continue;
+                }
+                size_t left = 0, right = block->size - 1;
+                while (left < right) {
+                    size_t mid = (left + right) >> 1;
+                    if (pred(slot::ref(block->at(mid)))) {
+                        left = mid + 1;
+                    } else {
+                        right = mid;
+                    }
+                }
+                return const_iterator(block, left, cur + left, &data);
+            }
+            return data.cend();
+        }
+
+        // 供插入删除使用的可写迭代器,位置与const版本相同
+        template<class Pred>
+        iterator partition_point(Pred pred) {
+            const_iterator it = static_cast<const sorted_deque *>(this)->partition_point(pred);
+            return iterator(it.cur_block, it.index, it.cur, &data, it.is_end);
+        }
+
+    public:
+        explicit sorted_deque(const Compare &comp = Compare()): comp(comp) {
+        }
+
+        /**
+         * return the first position whose element is not less than value.
+         */
+        const_iterator lower_bound(const T &value) const {
+            return partition_point([&](const T &x) { return comp(x, value); });
+        }
+
+        /**
+         * return the first position whose element is greater than value.
+         */
+        const_iterator upper_bound(const T &value) const {
+            return partition_point([&](const T &x) { return !comp(value, x); });
+        }
+
+        /**
+         * return the first element equivalent to value, or end().
+         */
+        const_iterator find(const T &value) const {
+            const_iterator it = lower_bound(value);
+            if (it != data.cend() && !comp(value, *it)) {
+                return it;
+            }
+            return data.cend();
+        }
+
+        size_t count(const T &value) const {
+            return upper_bound(value) - lower_bound(value);
+        }
+
+        /**
+         * insert value after all elements equivalent to it.
+         * return an iterator pointing to the inserted value.
+         */
+        const_iterator insert_sorted(const T &value) {
+            return data.insert(partition_point([&](const T &x) { return !comp(value, x); }), value);
+        }
+
+        /**
+         * remove one element equivalent to value.
+         * return whether such an element existed.
+         */
+        bool erase_value(const T &value) {
+            iterator it = partition_point([&](const T &x) { return comp(x, value); });
+            if (it == data.end() || comp(value, slot::ref(it.cur_block->at(it.index)))) {
+                return false;
+            }
+            data.erase(it);
+            return true;
+        }
+
+        const T &at(const size_t &pos) const {
+            return data.at(pos);
+        }
+
+        const T &operator[](const size_t &pos) const {
+            return data.at(pos);
+        }
+
+        // 最小元素和最大元素
+        const T &front() const {
+            return data.front();
+        }
+
+        const T &back() const {
+            return data.back();
+        }
+
+        void pop_front() {
+            data.pop_front();
+        }
+
+        void pop_back() {
+            data.pop_back();
+        }
+
+        const_iterator begin() const {
+            return data.cbegin();
+        }
+
+        const_iterator end() const {
+            return data.cend();
+        }
+
+        bool empty() const {
+            return data.empty();
+        }
+
+        size_t size() const {
+            return data.size();
+        }
+
+        void clear() {
+            data.clear();
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,408 @@
+#ifndef SJTU_SPILL_DEQUE_HPP
+#define SJTU_SPILL_DEQUE_HPP
+
+#include "deque.h"
+#include "exceptions.h"
+
+#include <cstddef>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sjtu {
+    /**
+     * 可以溢出到磁盘的双端队列,元素须平凡可复制.
+     * 元素按固定大小的页存放,页表本身是一个deque<page *>.
+     * 首页和尾页始终在内存中,头尾的插入删除和普通数组一样快;
+     * 中间的页按LRU顺序保留在内存预算之内,超出时写入溢出文件,访问时再读回.
+     * 消费者把首页(或尾页)用掉一半时,对下一页所在的文件区间发出预读提示.
+     */
+    template<class T>
+    class spill_deque {
+        static_assert(!deque_slot<T>::owns_heap, "spill_deque requires a trivially copyable element type");
+
+        struct page {
+            T *data; // 不在内存中时为nullptr
+            long long slot; // 在溢出文件中的页号,-1表示还没有写出过
+            bool dirty; // 内存中的内容比文件中的新
+            bool in_lru; // 只有中间页会进入LRU
+            page *lru_pre;
+            page *lru_next;
+        };
+
+        deque<page *> pages;
+        size_t head_offset; // 第一个元素在首页中的下标
+        size_t total_size;
+        size_t page_elements;
+        size_t max_resident; // 同时在内存中的页数上限,至少为3
+        size_t resident;
+        page *lru_head; // 最近使用
+        page *lru_tail; // 最久未使用,优先换出
+        int fd;
+        std::string path;
+        long long file_slots; // 文件中已经分配的页数
+        deque<long long> free_slots;
+        size_t spill_writes;
+        size_t spill_reads;
+
+        size_t pageBytes() const {
+            return page_elements * sizeof(T);
+        }
+
+        page *newPage() {
+            page *p = new page();
+            p->data = static_cast<T *>(::operator new(pageBytes()));
+            p->slot = -1;
+            p->dirty = true;
+            resident++;
+            return p;
+        }
+
+        void freePage(page *p) {
+            lruRemove(p);
+            if (p->data != nullptr) {
+                ::operator delete(p->data);
+                resident--;
+            }
+            if (p->slot >= 0) {
+                free_slots.push_back(p->slot);
+            }
+            delete p;
+        }
+
+        // 释放所有页及其内存,不改动页表、LRU链表和溢出文件
+        void releasePages() {
+            for (typename deque<page *>::const_iterator it = pages.cbegin(); it != pages.cend(); ++it) {
+                ::operator delete((*it)->data);
+                delete *it;
+            }
+            resident = 0;
+            lru_head = lru_tail = nullptr;
+        }
+
+        void lruRemove(page *p) {
+            if (!p->in_lru) {
+                return;
+            }
+            (p->lru_pre != nullptr ? p->lru_pre->lru_next : lru_head) = p->lru_next;
+            (p->lru_next != nullptr ? p->lru_next->lru_pre : lru_tail) = p->lru_pre;
+            p->lru_pre = p->lru_next = nullptr;
+            p->in_lru = false;
+        }
+
+        void lruPushFront(page *p) {
+            p->lru_pre = nullptr;
+            p->lru_next = lru_head;
+            (lru_head != nullptr ? lru_head->lru_pre : lru_tail) = p;
+            lru_head = p;
+            p->in_lru = true;
+        }
+
+        void evict(page *p) {
+            if (p->dirty || p->slot < 0) {
+                if (p->slot < 0) {
+                    if (!free_slots.empty()) {
+                        p->slot = free_slots.back();
+                        free_slots.pop_back();
+                    } else {
+                        p->slot = file_slots++;
+                    }
+                }
+                if (pwrite(fd, p->data, pageBytes(), static_cast<off_t>(p->slot * pageBytes())) !=
+                    static_cast<ssize_t>(pageBytes())) {
+                    throw runtime_error();
+                }
+                spill_writes++;
+            }
+            lruRemove(p);
+            ::operator delete(p->data);
+            p->data = nullptr;
+            p->dirty = false;
+            resident--;
+        }
+
+        // 换出最久未使用的中间页直到满足预算,keep本身不会被换出
+        void enforceBudget(page *keep) {
+            while (resident > max_resident && lru_tail != nullptr && lru_tail != keep) {
+                evict(lru_tail);
+            }
+        }
+
+        void load(page *p) {
+            if (p->data != nullptr) {
+                return;
+            }
+            p->data = static_cast<T *>(::operator new(pageBytes()));
+            resident++;
+            if (pread(fd, p->data, pageBytes(), static_cast<off_t>(p->slot * pageBytes())) !=
+                static_cast<ssize_t>(pageBytes())) {
+                throw runtime_error();
+            }
+            spill_reads++;
+            p->dirty = false;
+        }
+
+        // 访问中间页:读回内存并移到LRU最前
+        void touch(page *p) {
+            load(p);
+            lruRemove(p);
+            lruPushFront(p);
+            enforceBudget(p);
+        }
+
+        // 尾页或首页变成中间页
+        void demote(page *p) {
+            lruPushFront(p);
+            enforceBudget(p);
+        }
+
+        // 中间页变成首页或尾页
+        void promote(page *p) {
+            lruRemove(p);
+            load(p);
+            enforceBudget(p);
+        }
+
+        // 最后一个元素被取走:只留一页兼作首尾页,下一次插入从它的一端开始;
+        // 其余页的文件槽位交还free_slots,不截断文件,不做任何I/O
+        void drain() {
+            while (pages.size() > 1) {
+                freePage(pages.back());
+                pages.pop_back();
+            }
+            head_offset = 0;
+        }
+
+        void prefetch(page *p) {
+            if (p->data == nullptr) {
+#ifdef POSIX_FADV_WILLNEED
+                posix_fadvise(fd, static_cast<off_t>(p->slot * pageBytes()), static_cast<off_t>(pageBytes()),
+                              POSIX_FADV_WILLNEED);
+#endif
+            }
+        }
+
+        bool isMiddle(size_t k) const {
+            return k > 0 && k + 1 < pages.size();
+        }
+
+        // 定位第pos个元素,必要时把所在页读回内存
+        T &locate(size_t pos) {
+            size_t k = (head_offset + pos) / page_elements;
+            size_t offset = (head_offset + pos) % page_elements;
+            page *p = pages[k];
+            if (isMiddle(k)) {
+                touch(p);
+                if (offset == page_elements / 2 && isMiddle(k + 1)) {
+                    prefetch(pages[k + 1]);
+                }
+            }
+            return p->data[offset];
+        }
+
+    public:
+        typedef T value_type;
+
+        /**
+         * spill to the file at path (created or truncated, removed on destruction),
+         * keeping at most memory_budget bytes of pages resident (but never fewer
+         * than three pages).
+         */
+        spill_deque(const std::string &path, size_t memory_budget, size_t page_elements = 4096)
+            : head_offset(0), total_size(0), page_elements(page_elements), resident(0), lru_head(nullptr),
+              lru_tail(nullptr), path(path), file_slots(0), spill_writes(0), spill_reads(0) {
+            if (page_elements == 0) {
+                throw runtime_error();
+            }
+            max_resident = std::max(memory_budget / pageBytes(), static_cast<size_t>(3));
+            fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+            if (fd < 0) {
+                throw runtime_error();
+            }
+        }
+
+        spill_deque(const spill_deque &) = delete;
+
+        spill_deque &operator=(const spill_deque &) = delete;
+
+        ~spill_deque() {
+            // 文件随后就被删除,不必再截断,也不必登记空闲页号,析构不会抛出异常
+            releasePages();
+            close(fd);
+            unlink(path.c_str());
+        }
+
+        /**
+         * return a copy of a specified element with bound checking, reading its
+         * page back from disk if needed. the copy is returned by value because
+         * the next access may evict that page. throw index_out_of_bound if out
+         * of bound.
+         */
+        T at(const size_t &pos) {
+            if (pos >= total_size) {
+                throw index_out_of_bound();
+            }
+            return locate(pos);
+        }
+
+        T operator[](const size_t &pos) {
+            return at(pos);
+        }
+
+        /**
+         * overwrite a specified element. throw index_out_of_bound if out of bound.
+         */
+        void set(const size_t &pos, const T &value) {
+            if (pos >= total_size) {
+                throw index_out_of_bound();
+            }
+            locate(pos) = value;
+            pages[(head_offset + pos) / page_elements]->dirty = true;
+        }
+
+        const T &front() const {
+            if (empty()) {
+                throw container_is_empty();
+            }
+            return pages.front()->data[head_offset];
+        }
+
+        const T &back() const {
+            if (empty()) {
+                throw container_is_empty();
+            }
+            return pages.back()->data[(head_offset + total_size - 1) % page_elements];
+        }
+
+        bool empty() const {
+            return total_size == 0;
+        }
+
+        size_t size() const {
+            return total_size;
+        }
+
+        // 当前在内存中的页数和只在文件中的页数
+        size_t resident_pages() const {
+            return resident;
+        }
+
+        size_t spilled_pages() const {
+            return pages.size() - resident;
+        }
+
+        // 自构造以来写出和读回的页数
+        size_t spill_write_count() const {
+            return spill_writes;
+        }
+
+        size_t spill_read_count() const {
+            return spill_reads;
+        }
+
+        void clear() {
+            releasePages();
+            pages.clear();
+            free_slots.clear();
+            file_slots = 0;
+            head_offset = 0;
+            total_size = 0;
+            if (ftruncate(fd, 0) != 0) {
+                throw runtime_error();
+            }
+        }
+
+        void push_back(const T &value) {
+            if (empty()) {
+                head_offset = 0;
+            }
+            if (pages.empty() || head_offset + total_size == pages.size() * page_elements) {
+                page *p = newPage();
+                if (pages.size() >= 2) {
+                    demote(pages.back());
+                }
+                pages.push_back(p);
+                enforceBudget(p);
+            }
+            page *tail = pages.back();
+            tail->data[(head_offset + total_size) % page_elements] = value;
+            tail->dirty = true;
+            total_size++;
+        }
+
+        void push_front(const T &value) {
+            if (empty() && !pages.empty()) {
+                head_offset = page_elements;
+            }
+            if (pages.empty() || head_offset == 0) {
+                page *p = newPage();
+                if (pages.size() >= 2) {
+                    demote(pages.front());
+                }
+                pages.push_front(p);
+                enforceBudget(p);
+                head_offset = page_elements;
+            }
+            page *head = pages.front();
+            head_offset--;
+            head->data[head_offset] = value;
+            head->dirty = true;
+            total_size++;
+        }
+
+        /**
+         * remove the first element. reaching empty keeps one page resident and
+         * leaves the spill file alone; only clear() truncates it. when the
+         * head page runs out, the next page is read back first, so an I/O
+         * failure throws runtime_error with the queue unchanged.
+         */
+        void pop_front() {
+            if (empty()) {
+                throw container_is_empty();
+            }
+            if (total_size > 1 && head_offset + 1 == page_elements && pages.size() >= 3) {
+                promote(pages[1]);
+            }
+            head_offset++;
+            total_size--;
+            if (total_size == 0) {
+                drain();
+                return;
+            }
+            if (head_offset == page_elements) {
+                freePage(pages.front());
+                pages.pop_front();
+                head_offset = 0;
+            } else if (head_offset == page_elements / 2 && pages.size() > 2) {
+                prefetch(pages[1]);
+            }
+        }
+
+        /**
+         * the same as pop_front, for the last element.
+         */
+        void pop_back() {
+            if (empty()) {
+                throw container_is_empty();
+            }
+            size_t end = head_offset + total_size - 1;
+            if (total_size > 1 && end == (pages.size() - 1) * page_elements && pages.size() >= 3) {
+                promote(pages[pages.size() - 2]);
+            }
+            total_size--;
+            if (total_size == 0) {
+                drain();
+                return;
+            }
+            if (end == (pages.size() - 1) * page_elements) {
+                freePage(pages.back());
+                pages.pop_back();
+            } else if (end % page_elements == page_elements / 2 && pages.size() > 2) {
+                prefetch(pages[pages.size() - 2]);
+            }
+        }
+    };
+}
+
+#endif
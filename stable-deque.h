@@ -0,0 +1,310 @@
+#ifndef SJTU_STABLE_DEQUE_HPP
+#define SJTU_STABLE_DEQUE_HPP
+
+#include "deque.h"
+#include "exceptions.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+namespace sjtu {
+    /**
+     * 元素地址和句柄在deque重排(分裂、合并、扩容)之后仍然有效的双端队列.
+     * 元素放在分块的slab里,块一旦分配就不再移动;句柄是slab下标加代数,
+     * 元素被删除时代数加一,旧句柄随之失效,按句柄访问O(1).
+     * 顺序由deque<link>维护,每个link带一个单调递增的键(push_back取更大的键,
+     * push_front取更小的键),按句柄删除时像sorted_deque那样按块尾跳过整块、
+     * 块内二分找到位置再删除,O(sqrt n).
+     */
+    template<class T>
+    class stable_deque {
+    public:
+        // 元素的句柄,删除之后再使用会抛出invalid_iterator
+        struct handle {
+            size_t index;
+            size_t generation;
+
+            bool operator==(const handle &other) const {
+                return index == other.index && generation == other.generation;
+            }
+
+            bool operator!=(const handle &other) const {
+                return !(*this == other);
+            }
+        };
+
+    private:
+        static const size_t chunk_bits = 8;
+        static const size_t chunk_size = static_cast<size_t>(1) << chunk_bits;
+        static const size_t npos = static_cast<size_t>(-1);
+
+        struct entry {
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+            size_t generation;
+            long long key;
+            size_t next_free; // 空闲时指向下一个空闲下标
+            bool alive;
+
+            T &value() {
+                return *reinterpret_cast<T *>(&storage);
+            }
+        };
+
+        struct link {
+            long long key;
+            size_t index;
+        };
+
+        typedef typename deque<link>::Block Block;
+        typedef typename deque<link>::iterator order_iterator;
+
+        deque<link> order;
+        entry **chunks;
+        size_t chunk_count;
+        size_t chunk_capacity;
+        size_t slab_size; // 分配过的下标个数
+        size_t free_head;
+        long long front_key; // 下一次push_front使用的键
+        long long back_key; // 下一次push_back使用的键
+
+        entry &slab(size_t index) const {
+            return chunks[index >> chunk_bits][index & (chunk_size - 1)];
+        }
+
+        size_t acquire(const T &value, long long key) {
+            size_t index = free_head;
+            if (index == npos) {
+                if (slab_size == chunk_count * chunk_size) {
+                    if (chunk_count == chunk_capacity) {
+                        size_t new_capacity = chunk_capacity ? chunk_capacity * 2 : 4;
+                        entry **new_chunks = new entry *[new_capacity];
+                        for (size_t i = 0; i < chunk_count; i++) {
+                            new_chunks[i] = chunks[i];
+                        }
+                        delete[] chunks;
+                        chunks = new_chunks;
+                        chunk_capacity = new_capacity;
+                    }
+                    chunks[chunk_count] = static_cast<entry *>(::operator new(chunk_size * sizeof(entry)));
+                    for (size_t i = 0; i < chunk_size; i++) {
+                        chunks[chunk_count][i].generation = 0;
+                    }
+                    chunk_count++;
+                }
+                index = slab_size;
+            }
+            entry &e = slab(index);
+            new(&e.storage) T(value);
+            // 构造成功之后才占用下标,拷贝抛出异常时slab不变
+            if (index == slab_size) {
+                slab_size++;
+            } else {
+                free_head = e.next_free;
+            }
+            e.key = key;
+            e.alive = true;
+            return index;
+        }
+
+        void release(size_t index) {
+            entry &e = slab(index);
+            e.value().~T();
+            e.alive = false;
+            e.generation++;
+            e.next_free = free_head;
+            free_head = index;
+        }
+
+        entry &checked(const handle &h) const {
+            if (h.index >= slab_size) {
+                throw invalid_iterator();
+            }
+            entry &e = slab(h.index);
+            if (!e.alive || e.generation != h.generation) {
+                throw invalid_iterator();
+            }
+            return e;
+        }
+
+        // 定位键为key的link;键在order上严格递增
+        order_iterator locate(long long key) {
+            size_t cur = 0;
+            for (Block *block = order.head_block; block != nullptr; block = block->next) {
+                if (block->size == 0 || deque_slot<link>::ref(block->at(block->size - 1)).key < key) {
+                    cur += block->size;
+                    continue;
+                }
+                size_t left = 0, right = block->size - 1;
+                while (left < right) {
+                    size_t mid = (left + right) >> 1;
+                    if (deque_slot<link>::ref(block->at(mid)).key < key) {
+                        left = mid + 1;
+                    } else {
+                        right = mid;
+                    }
+                }
+                return order_iterator(block, left, cur + left, &order);
+            }
+            return order.end();
+        }
+
+    public:
+        typedef T value_type;
+
+        stable_deque(): chunks(nullptr), chunk_count(0), chunk_capacity(0), slab_size(0), free_head(npos),
+                        front_key(-1), back_key(0) {
+        }
+
+        stable_deque(const stable_deque &) = delete;
+
+        stable_deque &operator=(const stable_deque &) = delete;
+
+        ~stable_deque() {
+            clear();
+            for (size_t i = 0; i < chunk_count; i++) {
+                ::operator delete(chunks[i]);
+            }
+            delete[] chunks;
+        }
+
+        /**
+         * access the element of a handle in O(1).
+         * throw invalid_iterator if the element has been removed.
+         */
+        T &at(const handle &h) {
+            return checked(h).value();
+        }
+
+        const T &at(const handle &h) const {
+            return checked(h).value();
+        }
+
+        T &operator[](const handle &h) {
+            return at(h);
+        }
+
+        const T &operator[](const handle &h) const {
+            return at(h);
+        }
+
+        /**
+         * access the element at a position. throw index_out_of_bound if out of bound.
+         */
+        T &at(const size_t &pos) {
+            return slab(order.at(pos).index).value();
+        }
+
+        const T &at(const size_t &pos) const {
+            return slab(order.at(pos).index).value();
+        }
+
+        /**
+         * return the handle of the element at a position.
+         * throw index_out_of_bound if out of bound.
+         */
+        handle handle_at(const size_t &pos) const {
+            size_t index = order.at(pos).index;
+            return handle{index, slab(index).generation};
+        }
+
+        // 句柄指向的元素是否还在队列中
+        bool contains(const handle &h) const {
+            return h.index < slab_size && slab(h.index).alive && slab(h.index).generation == h.generation;
+        }
+
+        /**
+         * return the current position of the element of a handle, in O(sqrt n).
+         * throw invalid_iterator if the element has been removed.
+         */
+        size_t index_of(const handle &h) {
+            return locate(checked(h).key).cur;
+        }
+
+        /**
+         * remove the element of a handle, in O(sqrt n).
+         * throw invalid_iterator if the element has been removed.
+         */
+        void erase(const handle &h) {
+            order.erase(locate(checked(h).key));
+            release(h.index);
+        }
+
+        T &front() {
+            if (empty()) {
+                throw container_is_empty();
+            }
+            return slab(order.front().index).value();
+        }
+
+        T &back() {
+            if (empty()) {
+                throw container_is_empty();
+            }
+            return slab(order.back().index).value();
+        }
+
+        handle push_back(const T &value) {
+            size_t index = acquire(value, back_key);
+            // 链接失败时归还slab中的元素,否则它既不在队列里也无法再被释放
+            try {
+                order.push_back(link{back_key, index});
+            } catch (...) {
+                release(index);
+                throw;
+            }
+            back_key++;
+            return handle{index, slab(index).generation};
+        }
+
+        handle push_front(const T &value) {
+            size_t index = acquire(value, front_key);
+            try {
+                order.push_front(link{front_key, index});
+            } catch (...) {
+                release(index);
+                throw;
+            }
+            front_key--;
+            return handle{index, slab(index).generation};
+        }
+
+        void pop_front() {
+            if (empty()) {
+                throw container_is_empty();
+            }
+            size_t index = order.front().index;
+            order.pop_front();
+            release(index);
+        }
+
+        void pop_back() {
+            if (empty()) {
+                throw container_is_empty();
+            }
+            size_t index = order.back().index;
+            order.pop_back();
+            release(index);
+        }
+
+        bool empty() const {
+            return order.empty();
+        }
+
+        size_t size() const {
+            return order.size();
+        }
+
+        // 所有句柄失效,slab的内存保留下来供之后复用
+        void clear() {
+            for (typename deque<link>::const_iterator it = order.cbegin(); it != order.cend(); ++it) {
+                release(it->index);
+            }
+            order.clear();
+            front_key = -1;
+            back_key = 0;
+        }
+    };
+}
+
+#endif